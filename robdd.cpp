@@ -4,70 +4,338 @@
 #include <vector>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
 #include <set>
 #include <functional>
 #include <utility>
+#include <cstdint>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 
 using namespace std;
 
+// -------------------------------- Memory Accounting --------------------------------------//
+// Estimated bytes held per subsystem, with high-water marks. The node arena, the
+// unique/node tables and the computed cache are charged through their allocations, at the
+// requested sizes and without allocator overhead; symbol, parser and gate structures are
+// re-measured whenever they change from libstdc++'s container layouts. Resetting the BDD
+// tables frees their nodes, so the node arena drops with it. Counters are atomic because split construction charges from several threads at
+// once. The total is kept as its own running counter, so a charge costs two atomic adds
+// however many subsystems there are.
+
+enum MemSubsystem {
+    MEM_NODES, MEM_UNIQUE_TABLE, MEM_COMPUTED_CACHE, MEM_SYMBOLS, MEM_PARSER, MEM_GATES, MEM_COUNT
+};
+
+const char* memSubsystemNames[MEM_COUNT] = {"node arena", "unique table", "computed cache", "symbol table",
+                                            "parser buffers", "gate graph"};
+
+atomic<int64_t> memCurrent[MEM_COUNT] = {};
+atomic<int64_t> memPeak[MEM_COUNT] = {};
+atomic<int64_t> memTotal{0};
+atomic<int64_t> memTotalPeak{0};
+
+static void raisePeak(atomic<int64_t>& peak, int64_t value) {
+    int64_t seen = peak.load(memory_order_relaxed);
+    while (seen < value && !peak.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+    }
+}
+
+void memCharge(MemSubsystem subsystem, int64_t bytes) {
+    int64_t current = memCurrent[subsystem].fetch_add(bytes, memory_order_relaxed) + bytes;
+    raisePeak(memPeak[subsystem], current);
+    raisePeak(memTotalPeak, memTotal.fetch_add(bytes, memory_order_relaxed) + bytes);
+}
+
+// For re-measured structures: `charged` is what the structure was charged last time.
+void memRecharge(MemSubsystem subsystem, int64_t& charged, int64_t bytes) {
+    memCharge(subsystem, bytes - charged);
+    charged = bytes;
+}
+
+template <class T, MemSubsystem S>
+struct TrackingAllocator {
+    using value_type = T;
+
+    TrackingAllocator() = default;
+    template <class U>
+    TrackingAllocator(const TrackingAllocator<U, S>&) {}
+
+    template <class U>
+    struct rebind {
+        using other = TrackingAllocator<U, S>;
+    };
+
+    T* allocate(size_t n) {
+        memCharge(S, (int64_t)(n * sizeof(T)));
+        return allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        memCharge(S, -(int64_t)(n * sizeof(T)));
+        allocator<T>().deallocate(p, n);
+    }
+
+    template <class U>
+    bool operator==(const TrackingAllocator<U, S>&) const { return true; }
+    template <class U>
+    bool operator!=(const TrackingAllocator<U, S>&) const { return false; }
+};
+
+const size_t RB_NODE_OVERHEAD = 32;  // colour + parent/left/right pointers of a std::map node
+const size_t SSO_CAPACITY = 15;      // longest string kept inline by std::string
+
+size_t stringHeapBytes(const string& s) {
+    return s.capacity() > SSO_CAPACITY ? s.capacity() + 1 : 0;
+}
+
+size_t stringVectorBytes(const vector<string>& v) {
+    size_t bytes = v.capacity() * sizeof(string);
+    for (const string& s : v) bytes += stringHeapBytes(s);
+    return bytes;
+}
+
+template <class V>
+size_t stringMapBytes(const map<string, V>& m) {
+    size_t bytes = m.size() * (RB_NODE_OVERHEAD + sizeof(pair<const string, V>));
+    for (const auto& entry : m) bytes += stringHeapBytes(entry.first);
+    return bytes;
+}
+
+void printMemoryReport() {
+    cout << "Estimated memory by subsystem (current / peak bytes):" << endl;
+    for (int s = 0; s < MEM_COUNT; ++s)
+        cout << "  " << memSubsystemNames[s] << ": " << memCurrent[s].load() << " / " << memPeak[s].load() << endl;
+    cout << "  total: " << memTotal.load() << " / " << memTotalPeak.load() << endl;
+}
+
 // -------------------------------- BDD Node Structure --------------------------------------//
 struct BDDNode {
     int id;
     string variable;
     BDDNode* low;
     BDDNode* high;
+    uint32_t foldMark = 0;   // traversal epoch that last visited the node (see Node Collection)
+    uint32_t foldIndex = 0;  // position in that traversal's node array
 
     BDDNode(string var, BDDNode* l, BDDNode* h) : variable(var), low(l), high(h) {
-        static int counter = 0;
+        static atomic<int> counter{0};  // ids stay unique across the per-thread managers
         id = counter++;
+        memCharge(MEM_NODES, (int64_t)(sizeof(BDDNode) + stringHeapBytes(variable)));
+    }
+
+    ~BDDNode() { memCharge(MEM_NODES, -(int64_t)(sizeof(BDDNode) + stringHeapBytes(variable))); }
+};
+
+// Terminal nodes, shared by every manager
+BDDNode* const BDD_ZERO = new BDDNode("0", nullptr, nullptr);
+BDDNode* const BDD_ONE = new BDDNode("1", nullptr, nullptr);
+
+using LevelTable = map<pair<int, int>, BDDNode*, less<pair<int, int>>,
+                       TrackingAllocator<pair<const pair<int, int>, BDDNode*>, MEM_UNIQUE_TABLE>>;
+
+// Apply's computed cache: direct-mapped and lossy, keyed by the operand ids and the op's
+// truth table, so every OpFunc shares it. Results point into the current tables, so the
+// cache is dropped whenever they are reset or reordered. Zero entries turns it off.
+struct ApplyCacheEntry {
+    int f = -1;
+    int g = -1;
+    int op = -1;
+    BDDNode* result = nullptr;
+};
+
+// Everything one BDD manager owns. Every function works on the calling thread's current
+// manager, which is mainManager on every thread unless a ManagerScope installs another
+// one: split construction and block sifting hand each worker thread a manager of its own,
+// and scratch work that must not disturb the caller's BDDs runs in a temporary one. Nodes
+// belong to the manager that made them; move them across with makeNode (see
+// importNode). A manager deletes the nodes in its node table when it goes away.
+// Other threads may read the main manager's nodes and order (as the parallel folds do)
+// but must not build in it concurrently.
+struct BDDManager {
+    vector<LevelTable, TrackingAllocator<LevelTable, MEM_UNIQUE_TABLE>> uniqueTable;  // one sub-table per level
+    map<int, BDDNode*, less<int>, TrackingAllocator<pair<const int, BDDNode*>, MEM_UNIQUE_TABLE>> nodeTable;
+
+    // Variables get a stable ID when they are registered. levelVar/varLevel are the
+    // permutation between IDs and levels, and variableOrder mirrors levelVar by name.
+    vector<string> variableOrder;
+    vector<string> variableNames;   // ID -> name
+    map<string, int> variableId;    // name -> ID
+    vector<int> varLevel;           // ID -> level
+    vector<int> levelVar;           // level -> ID
+    int64_t chargedSymbolBytes = 0;
+
+    vector<ApplyCacheEntry, TrackingAllocator<ApplyCacheEntry, MEM_COMPUTED_CACHE>> applyCache;
+
+    BDDManager() = default;
+    BDDManager(const BDDManager&) = delete;
+    BDDManager& operator=(const BDDManager&) = delete;
+    ~BDDManager() {
+        for (const auto& entry : nodeTable) delete entry.second;
+        memCharge(MEM_SYMBOLS, -chargedSymbolBytes);
     }
 };
 
-// Terminal nodes (will be initialized later)
-BDDNode* BDD_ZERO = nullptr;
-BDDNode* BDD_ONE = nullptr;
+BDDManager mainManager;
+thread_local BDDManager* manager = &mainManager;
+
+// Makes `m` the calling thread's manager until the scope ends.
+class ManagerScope {
+private:
+    BDDManager* previous;
 
-// Unique table and node table
-map<pair<string, pair<int, int>>, BDDNode*> uniqueTable;
-map<int, BDDNode*> nodeTable;
+public:
+    explicit ManagerScope(BDDManager& m) : previous(manager) { manager = &m; }
+    ~ManagerScope() { manager = previous; }
+    ManagerScope(const ManagerScope&) = delete;
+    ManagerScope& operator=(const ManagerScope&) = delete;
+};
 
 // Forward declarations (used later)
 class ROBDDBuilder;
-BDDNode* rebuildROBDD(const string& verilogCode);
+BDDNode* rebuildROBDD(const string& verilogCode, vector<BDDNode*>* outputs = nullptr);
+void clearApplyCache();
+
+// -------------------------------- Variable Ordering --------------------------------------//
+
+void accountSymbolMemory() {
+    size_t bytes = stringVectorBytes(manager->variableOrder) + stringVectorBytes(manager->variableNames) + stringMapBytes(manager->variableId) +
+                   (manager->varLevel.capacity() + manager->levelVar.capacity()) * sizeof(int);
+    memRecharge(MEM_SYMBOLS, manager->chargedSymbolBytes, (int64_t)bytes);
+}
+
+// Replaces the whole order and resyncs the level permutation with it (sifting edits
+// variableOrder directly). Nodes are not restructured, so while the manager holds inner
+// nodes only the installed order is accepted; anything else returns false and changes
+// nothing (call resetBDDTables first). Variables that stay in the order keep their IDs,
+// dropped ones are unregistered, and an empty order starts IDs over from 0.
+bool setVariableOrder(const vector<string>& vars) {
+    if (!manager->nodeTable.empty()) {
+        bool installed = vars.size() == manager->levelVar.size();
+        for (size_t l = 0; installed && l < vars.size(); ++l) installed = manager->variableNames[manager->levelVar[l]] == vars[l];
+        if (installed) manager->variableOrder = vars;
+        return installed;
+    }
+    clearApplyCache();
+    manager->uniqueTable.assign(vars.size(), LevelTable());
+
+    if (vars.empty()) {
+        manager->variableNames.clear();
+        manager->varLevel.clear();
+    }
+    map<string, int> ids;
+    for (const string& var : vars) {
+        auto it = manager->variableId.find(var);
+        if (it != manager->variableId.end()) {
+            ids[var] = it->second;
+            continue;
+        }
+        ids[var] = (int)manager->variableNames.size();
+        manager->variableNames.push_back(var);
+        manager->varLevel.push_back(-1);
+    }
+    for (const auto& entry : manager->variableId) {
+        if (!ids.count(entry.first)) manager->varLevel[entry.second] = -1;
+    }
+
+    manager->variableOrder = vars;
+    manager->variableId.swap(ids);
+    manager->levelVar.clear();
+    for (int l = 0; l < (int)vars.size(); l++) {
+        int id = manager->variableId[vars[l]];
+        manager->varLevel[id] = l;
+        manager->levelVar.push_back(id);
+    }
+    accountSymbolMemory();
+    return true;
+}
+
+int getVariableIndex(const string& var) {
+    auto it = manager->variableId.find(var);
+    if (it != manager->variableId.end()) return manager->varLevel[it->second];
+    return (int)manager->variableOrder.size(); // constants go after vars
+}
+
+// Inserts a fresh variable at the given level (clamped to [0, #vars]) and returns its ID.
+// Deeper levels shift down by one in place; no node is touched, since a new variable
+// cannot appear in any existing BDD. A name that is already registered keeps its level.
+int newVarAtLevel(int level, const string& name = "") {
+    if (!name.empty()) {
+        auto it = manager->variableId.find(name);
+        if (it != manager->variableId.end()) return it->second;
+    }
+
+    int id = (int)manager->variableNames.size();
+    string var = name.empty() ? "v" + to_string(id) : name;
+    level = max(0, min(level, (int)manager->variableOrder.size()));
+
+    manager->variableNames.push_back(var);
+    manager->variableId[var] = id;
+    manager->varLevel.push_back(level);
+    manager->levelVar.insert(manager->levelVar.begin() + level, id);
+    manager->variableOrder.insert(manager->variableOrder.begin() + level, var);
+    manager->uniqueTable.insert(manager->uniqueTable.begin() + level, LevelTable());
+    for (int l = level + 1; l < (int)manager->levelVar.size(); ++l) manager->varLevel[manager->levelVar[l]] = l;
+    accountSymbolMemory();
+    return id;
+}
 
 // -------------------------------- Create node with reduction --------------------------------------//
+// The variable must already be registered, through setVariableOrder or newVarAtLevel.
 BDDNode* makeNode(const string& var, BDDNode* low, BDDNode* high) {
     if (low == high) return low;
 
-    pair<string, pair<int, int>> key = make_pair(var, make_pair(low->id, high->id));
+    int level = getVariableIndex(var);
+    if (level == (int)manager->variableOrder.size()) {
+        cerr << "makeNode: variable " << var << " is not in the variable order" << endl;
+        abort();
+    }
+    if ((int)manager->uniqueTable.size() < (int)manager->variableOrder.size()) manager->uniqueTable.resize(manager->variableOrder.size());
+
+    LevelTable& table = manager->uniqueTable[level];
+    pair<int, int> key = make_pair(low->id, high->id);
 
-    auto it = uniqueTable.find(key);
-    if (it != uniqueTable.end()) return it->second;
+    auto it = table.find(key);
+    if (it != table.end()) return it->second;
 
     BDDNode* node = new BDDNode(var, low, high);
-    uniqueTable[key] = node;
-    nodeTable[node->id] = node;
+    table[key] = node;
+    manager->nodeTable[node->id] = node;
     return node;
 }
 
-// -------------------------------- Variable Ordering --------------------------------------//
-vector<string> variableOrder;
-map<string, int> variableIndex;
-
-void setVariableOrder(const vector<string>& vars) {
-    variableOrder = vars;
-    variableIndex.clear();
-    for (int i = 0; i < (int)vars.size(); i++) variableIndex[vars[i]] = i;
-}
+// Copies a node of another manager into the current one. The terminals are shared.
+static BDDNode* importNode(BDDNode* n, map<int, BDDNode*>& memo) {
+    if (n == BDD_ZERO || n == BDD_ONE) return n;
 
-int getVariableIndex(const string& var) {
-    auto it = variableIndex.find(var);
-    if (it != variableIndex.end()) return it->second;
-    return (int)variableOrder.size(); // constants go after vars
+    auto it = memo.find(n->id);
+    if (it != memo.end()) return it->second;
+    BDDNode* result = makeNode(n->variable, importNode(n->low, memo), importNode(n->high, memo));
+    memo[n->id] = result;
+    return result;
 }
 
 int computeBDDSize() {
-    return (int)nodeTable.size();
+    return (int)manager->nodeTable.size();
 }
 
 // -------------------------------- BDD Operations --------------------------------------//
@@ -82,16 +350,44 @@ OpFunc NorOp  = [](bool a, bool b) { return !(a || b); };
 inline bool isTerminal(BDDNode* n) { return n == BDD_ZERO || n == BDD_ONE; }
 inline bool valueOf(BDDNode* n) { return n == BDD_ONE; }
 
-BDDNode* apply(BDDNode* f, BDDNode* g, OpFunc op) {
+size_t applyCacheEntries = (size_t)1 << 16;  // per manager, a power of two
+
+void setApplyCacheEntries(size_t entries) {
+    size_t size = 0;
+    if (entries > 0) {
+        size = 1;
+        while (size < entries) size <<= 1;
+    }
+    applyCacheEntries = size;
+}
+
+void clearApplyCache() {
+    manager->applyCache.clear();
+    manager->applyCache.shrink_to_fit();
+}
+
+// Bit 2a+b is op(a, b).
+static int opTruthTable(const OpFunc& op) {
+    return (int)op(false, false) | (int)op(false, true) << 1 | (int)op(true, false) << 2 | (int)op(true, true) << 3;
+}
+
+static BDDNode* applyRec(BDDNode* f, BDDNode* g, const OpFunc& op, int opCode) {
     if (isTerminal(f) && isTerminal(g)) {
         return op(valueOf(f), valueOf(g)) ? BDD_ONE : BDD_ZERO;
     }
 
+    ApplyCacheEntry* slot = nullptr;
+    if (!manager->applyCache.empty()) {
+        uint64_t hash = (uint64_t)(uint32_t)f->id * 0x9E3779B97F4A7C15ULL ^ (uint64_t)(uint32_t)g->id * 0xC2B2AE3D27D4EB4FULL;
+        slot = &manager->applyCache[(hash ^ (hash >> 29) ^ (uint64_t)opCode) & (manager->applyCache.size() - 1)];
+        if (slot->f == f->id && slot->g == g->id && slot->op == opCode) return slot->result;
+    }
+
     string f_var = isTerminal(f) ? "" : f->variable;
     string g_var = isTerminal(g) ? "" : g->variable;
 
-    int f_index = f_var.empty() ? (int)variableOrder.size() : getVariableIndex(f_var);
-    int g_index = g_var.empty() ? (int)variableOrder.size() : getVariableIndex(g_var);
+    int f_index = f_var.empty() ? (int)manager->variableOrder.size() : getVariableIndex(f_var);
+    int g_index = g_var.empty() ? (int)manager->variableOrder.size() : getVariableIndex(g_var);
 
     string var;
     BDDNode *f_low, *f_high, *g_low, *g_high;
@@ -110,10 +406,17 @@ BDDNode* apply(BDDNode* f, BDDNode* g, OpFunc op) {
         g_low = g->low;  g_high = g->high;
     }
 
-    BDDNode* low  = apply(f_low, g_low, op);
-    BDDNode* high = apply(f_high, g_high, op);
+    BDDNode* low  = applyRec(f_low, g_low, op, opCode);
+    BDDNode* high = applyRec(f_high, g_high, op, opCode);
 
-    return makeNode(var, low, high);
+    BDDNode* result = makeNode(var, low, high);
+    if (slot) *slot = ApplyCacheEntry{f->id, g->id, opCode, result};
+    return result;
+}
+
+BDDNode* apply(BDDNode* f, BDDNode* g, OpFunc op) {
+    if (manager->applyCache.size() != applyCacheEntries) manager->applyCache.assign(applyCacheEntries, ApplyCacheEntry());
+    return applyRec(f, g, op, opTruthTable(op));
 }
 
 BDDNode* bddNot(BDDNode* f) {
@@ -121,6 +424,180 @@ BDDNode* bddNot(BDDNode* f) {
     return makeNode(f->variable, bddNot(f->low), bddNot(f->high));
 }
 
+static BDDNode* bddRestrictRec(BDDNode* f, const string& var, int level, bool value, map<int, BDDNode*>& memo) {
+    if (isTerminal(f) || getVariableIndex(f->variable) > level) return f;
+    if (f->variable == var) return value ? f->high : f->low;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+    BDDNode* result = makeNode(f->variable, bddRestrictRec(f->low, var, level, value, memo),
+                               bddRestrictRec(f->high, var, level, value, memo));
+    memo[f->id] = result;
+    return result;
+}
+
+// Cofactor of f with var fixed to value.
+BDDNode* bddRestrict(BDDNode* f, const string& var, bool value) {
+    map<int, BDDNode*> memo;
+    return bddRestrictRec(f, var, getVariableIndex(var), value, memo);
+}
+
+// -------------------------------- Phase Profiling --------------------------------------//
+// Optional wall-clock and hardware-counter attribution to the manager's phases. Time and
+// counts go to the innermost active phase (exclusive) and to every phase on the stack
+// (inclusive), so apply work done inside a sift shows up under both. Hardware counters
+// come from perf_event_open and are simply reported as unavailable when the kernel
+// refuses them. Profiling covers the thread that enabled it; worker threads are not sampled.
+
+enum PerfPhase { PHASE_PARSE, PHASE_BUILD, PHASE_APPLY, PHASE_SIFT, PHASE_GC, PHASE_COUNT };
+enum PerfCounter { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_L1D_MISSES, COUNTER_LLC_MISSES,
+                   COUNTER_BRANCH_MISSES, COUNTER_COUNT };
+
+const char* perfPhaseNames[PHASE_COUNT] = {"parse", "build", "apply", "sift", "gc"};
+const char* perfCounterNames[COUNTER_COUNT] = {"cycles", "instructions", "l1d-misses", "llc-misses",
+                                               "branch-misses"};
+
+struct PhaseStats {
+    uint64_t calls = 0;
+    double seconds = 0;
+    double inclusiveSeconds = 0;
+    uint64_t counters[COUNTER_COUNT] = {};
+    uint64_t inclusiveCounters[COUNTER_COUNT] = {};
+};
+
+struct PhaseSample {
+    double seconds;
+    uint64_t counters[COUNTER_COUNT];
+};
+
+thread_local bool phaseProfilingEnabled = false;
+int perfCounterFds[COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+PhaseStats phaseStats[PHASE_COUNT];
+thread_local vector<pair<PerfPhase, PhaseSample>> phaseStack;  // active phase and the sample taken on entry
+thread_local PhaseSample lastPhaseSample;
+
+static int openPerfCounter(uint32_t type, uint64_t config) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void)type;
+    (void)config;
+    return -1;
+#endif
+}
+
+static PhaseSample takePhaseSample() {
+    PhaseSample sample;
+    sample.seconds = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        uint64_t value = 0;
+        if (perfCounterFds[c] >= 0 && read(perfCounterFds[c], &value, sizeof(value)) != (ssize_t)sizeof(value))
+            value = 0;
+        sample.counters[c] = value;
+    }
+    return sample;
+}
+
+// Turns phase profiling on. Returns whether at least one hardware counter could be opened;
+// timing is collected either way.
+bool enablePhaseProfiling() {
+#ifdef __linux__
+    perfCounterFds[COUNTER_CYCLES] = openPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perfCounterFds[COUNTER_INSTRUCTIONS] = openPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perfCounterFds[COUNTER_L1D_MISSES] = openPerfCounter(
+        PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    perfCounterFds[COUNTER_LLC_MISSES] = openPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    perfCounterFds[COUNTER_BRANCH_MISSES] = openPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    phaseProfilingEnabled = true;
+    lastPhaseSample = takePhaseSample();
+
+    bool anyCounter = false;
+    for (int c = 0; c < COUNTER_COUNT; ++c) anyCounter = anyCounter || perfCounterFds[c] >= 0;
+    return anyCounter;
+}
+
+// Charges everything since the last sample to the innermost active phase.
+static PhaseSample chargeActivePhase() {
+    PhaseSample now = takePhaseSample();
+    if (!phaseStack.empty()) {
+        PhaseStats& stats = phaseStats[phaseStack.back().first];
+        stats.seconds += now.seconds - lastPhaseSample.seconds;
+        for (int c = 0; c < COUNTER_COUNT; ++c) stats.counters[c] += now.counters[c] - lastPhaseSample.counters[c];
+    }
+    lastPhaseSample = now;
+    return now;
+}
+
+class PhaseScope {
+private:
+    bool active;
+
+public:
+    explicit PhaseScope(PerfPhase phase) : active(phaseProfilingEnabled) {
+        if (!active) return;
+        PhaseSample now = chargeActivePhase();
+        phaseStats[phase].calls++;
+        phaseStack.push_back(make_pair(phase, now));
+    }
+
+    ~PhaseScope() {
+        if (!active) return;
+        PhaseSample now = chargeActivePhase();
+        PhaseStats& stats = phaseStats[phaseStack.back().first];
+        const PhaseSample& entry = phaseStack.back().second;
+        stats.inclusiveSeconds += now.seconds - entry.seconds;
+        for (int c = 0; c < COUNTER_COUNT; ++c) stats.inclusiveCounters[c] += now.counters[c] - entry.counters[c];
+        phaseStack.pop_back();
+    }
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+};
+
+void printStatsReport() {
+    bool anyCounter = false;
+    for (int c = 0; c < COUNTER_COUNT; ++c) anyCounter = anyCounter || perfCounterFds[c] >= 0;
+
+    cout << "Phase statistics (exclusive; inclusive time in parentheses):" << endl;
+    if (!anyCounter) cout << "  (hardware counters unavailable)" << endl;
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        const PhaseStats& stats = phaseStats[p];
+        if (stats.calls == 0) continue;
+        cout << "  " << perfPhaseNames[p] << ": " << stats.calls << " calls, " << stats.seconds << " s ("
+             << stats.inclusiveSeconds << " s)" << endl;
+
+        for (int c = 0; c < COUNTER_COUNT && anyCounter; ++c) {
+            cout << "    " << perfCounterNames[c] << ": ";
+            if (perfCounterFds[c] >= 0) cout << stats.counters[c] << endl;
+            else cout << "n/a" << endl;
+        }
+
+        uint64_t cycles = stats.counters[COUNTER_CYCLES];
+        uint64_t instructions = stats.counters[COUNTER_INSTRUCTIONS];
+        if (perfCounterFds[COUNTER_CYCLES] < 0 || perfCounterFds[COUNTER_INSTRUCTIONS] < 0 || cycles == 0 ||
+            instructions == 0)
+            continue;
+
+        // Low IPC together with frequent last-level misses points at memory stalls.
+        double ipc = (double)instructions / (double)cycles;
+        cout << "    ipc: " << ipc;
+        if (perfCounterFds[COUNTER_LLC_MISSES] >= 0) {
+            double mpki = 1000.0 * (double)stats.counters[COUNTER_LLC_MISSES] / (double)instructions;
+            cout << ", llc mpki: " << mpki << " -> " << (ipc < 1.0 && mpki > 5.0 ? "memory-bound" : "compute-bound");
+        }
+        cout << endl;
+    }
+}
+
 // -------------------------------- Verilog Parser --------------------------------------//
 struct Gate {
     string type;
@@ -136,9 +613,51 @@ private:
     vector<string> regs;
     vector<Gate> gates;
     map<string, BDDNode*> signalBDDs;
+    int64_t chargedParserBytes = 0;
+    int64_t chargedGateBytes = 0;
 
 public:
-    void parse(const string& verilogCode) {
+    VerilogParser() = default;
+
+    VerilogParser(const VerilogParser& other)
+        : inputs(other.inputs), outputs(other.outputs), wires(other.wires), regs(other.regs), gates(other.gates),
+          signalBDDs(other.signalBDDs) {
+        accountMemory();
+    }
+
+    VerilogParser& operator=(const VerilogParser& other) {
+        inputs = other.inputs;
+        outputs = other.outputs;
+        wires = other.wires;
+        regs = other.regs;
+        gates = other.gates;
+        signalBDDs = other.signalBDDs;
+        accountMemory();
+        return *this;
+    }
+
+    ~VerilogParser() {
+        memCharge(MEM_PARSER, -chargedParserBytes);
+        memCharge(MEM_GATES, -chargedGateBytes);
+    }
+
+    // Re-measures the declaration lists, the signal table and the gate list.
+    void accountMemory() {
+        size_t parserBytes = stringVectorBytes(inputs) + stringVectorBytes(outputs) + stringVectorBytes(wires) +
+                             stringVectorBytes(regs) + stringMapBytes(signalBDDs);
+        size_t gateBytes = gates.capacity() * sizeof(Gate);
+        for (const Gate& gate : gates) {
+            gateBytes += stringHeapBytes(gate.type) + stringHeapBytes(gate.output) + stringVectorBytes(gate.inputs);
+        }
+        memRecharge(MEM_PARSER, chargedParserBytes, (int64_t)parserBytes);
+        memRecharge(MEM_GATES, chargedGateBytes, (int64_t)gateBytes);
+    }
+
+    // Parses the design and installs its variable order in the current manager. Returns
+    // false, leaving the inputs without BDDs, when live nodes pin a different order; reset
+    // the tables before parsing a design with other inputs.
+    bool parse(const string& verilogCode) {
+        PhaseScope phase(PHASE_PARSE);
         stringstream ss(verilogCode);
         string line;
 
@@ -168,8 +687,22 @@ public:
             }
         }
 
-        setVariableOrder(inputs);
-        initializeInputBDDs();
+        // Keep an order that already places every input: it comes from sifting or holds extra
+        // variables added with newVarAtLevel. Re-applying it resyncs the level permutation.
+        bool installed = orderCoversInputs() ? setVariableOrder(manager->variableOrder) : setVariableOrder(inputs);
+        if (installed) initializeInputBDDs();
+        else cerr << "Cannot install the design's variable order while other BDDs are live" << endl;
+        accountMemory();
+        return installed;
+    }
+
+    bool orderCoversInputs() const {
+        if (inputs.empty() || manager->variableOrder.size() < inputs.size()) return false;
+        set<string> ordered(manager->variableOrder.begin(), manager->variableOrder.end());
+        for (const string& input : inputs) {
+            if (!ordered.count(input)) return false;
+        }
+        return true;
     }
 
     void parseInput(const string& line) {
@@ -280,32 +813,187 @@ public:
     }
 
     void setSignalBDD(const string& signal, BDDNode* bdd) {
-        signalBDDs[signal] = bdd;
+        auto inserted = signalBDDs.insert(make_pair(signal, bdd));
+        if (!inserted.second) {
+            inserted.first->second = bdd;
+            return;
+        }
+        int64_t bytes = (int64_t)(RB_NODE_OVERHEAD + sizeof(pair<const string, BDDNode*>) +
+                                  stringHeapBytes(inserted.first->first));
+        chargedParserBytes += bytes;
+        memCharge(MEM_PARSER, bytes);
     }
 
-    vector<string> getInputs() const { return inputs; }
+    // Sequential designs: `dff(q, d)` makes q a register whose next state is d. Removes
+    // those gates from the netlist and turns their registers into pseudo-inputs, so the
+    // rest of the netlist builds as combinational logic over inputs and current state.
+    // Returns (register, next-state signal) pairs.
+    vector<pair<string, string>> cutRegisters() {
+        vector<pair<string, string>> latches;
+        vector<Gate> kept;
+        for (const Gate& gate : gates) {
+            if ((gate.type == "dff" || gate.type == "DFF") && gate.inputs.size() == 1)
+                latches.push_back(make_pair(gate.output, gate.inputs[0]));
+            else
+                kept.push_back(gate);
+        }
+        gates.swap(kept);
+
+        for (const auto& latch : latches) {
+            if (find(inputs.begin(), inputs.end(), latch.first) != inputs.end()) continue;
+            inputs.push_back(latch.first);
+            newVarAtLevel((int)manager->variableOrder.size(), latch.first);
+            setSignalBDD(latch.first, makeNode(latch.first, BDD_ZERO, BDD_ONE));
+        }
+        accountMemory();
+        return latches;
+    }
+
+    const vector<string>& getInputs() const { return inputs; }
     vector<string> getOutputs() const { return outputs; }
     vector<Gate> getGates() const { return gates; }
     map<string, BDDNode*> getSignalBDDs() const { return signalBDDs; }
 };
 
+// -------------------------------- Gate Scheduling --------------------------------------//
+// Order in which processGates evaluates gates. Levelized sweeps the gate list repeatedly;
+// the cone policies finish one output cone before starting the next.
+enum class SchedulePolicy { Levelized, DepthFirstCone, ConeMaxFree };
+
+SchedulePolicy gateSchedulePolicy = SchedulePolicy::Levelized;
+
+const char* schedulePolicyName(SchedulePolicy policy) {
+    switch (policy) {
+        case SchedulePolicy::Levelized: return "levelized";
+        case SchedulePolicy::DepthFirstCone: return "dfs";
+        case SchedulePolicy::ConeMaxFree: return "maxfree";
+    }
+    return "unknown";
+}
+
+bool parseSchedulePolicy(const string& name, SchedulePolicy& policy) {
+    for (SchedulePolicy p : {SchedulePolicy::Levelized, SchedulePolicy::DepthFirstCone, SchedulePolicy::ConeMaxFree}) {
+        if (name == schedulePolicyName(p)) {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+enum GateState { GATE_PENDING, GATE_ACTIVE, GATE_DONE };
+
+// Defined with the node collection helpers further down.
+vector<BDDNode*> collectNodes(const vector<BDDNode*>& roots);
+
 // -------------------------------- ROBDD Builder --------------------------------------//
 class ROBDDBuilder {
 private:
     VerilogParser parser;
+    SchedulePolicy schedulePolicy = gateSchedulePolicy;
+    bool trackLiveNodes = false;
+    int peakLiveNodes = 0;
+    map<string, int> remainingFanout;
+    set<string> liveSignals;
+    set<string> outputSet;
+    vector<Gate> coneGates;
+    map<string, size_t> coneDriver;
+    vector<GateState> coneState;
+    bool lazy = false;
+    map<string, bool> fixedInputs;
+
+    void applyFixedInputs() {
+        for (const auto& fixed : fixedInputs) parser.setSignalBDD(fixed.first, fixed.second ? BDD_ONE : BDD_ZERO);
+    }
 
 public:
+    // nullptr when the design cannot be parsed into the current manager.
     BDDNode* buildROBDD(const string& verilogCode) {
-        parser.parse(verilogCode);
+        if (!parser.parse(verilogCode)) return nullptr;
+        applyFixedInputs();
+        lazy = false;
         processGates();
         if (!parser.getOutputs().empty()) return parser.getSignalBDD(parser.getOutputs()[0]);
         return BDD_ZERO;
     }
 
+    // Defined with the split construction further down.
+    BDDNode* buildSplitROBDD(const string& verilogCode, int splitDepth = -1);
+
+    // Builds a design with dff registers: every signal becomes a function of the inputs and
+    // the current register values. Returns each register with its next-state BDD, or
+    // nothing when the design cannot be parsed into the current manager.
+    vector<pair<string, BDDNode*>> buildSequential(const string& verilogCode) {
+        if (!parser.parse(verilogCode)) return {};
+        applyFixedInputs();
+        vector<pair<string, string>> latches = parser.cutRegisters();
+        lazy = false;
+        processGates();
+
+        vector<pair<string, BDDNode*>> nextState;
+        for (const auto& latch : latches) {
+            BDDNode* d = parser.getSignalBDD(latch.second);
+            nextState.push_back(make_pair(latch.first, d ? d : BDD_ZERO));
+        }
+        return nextState;
+    }
+
+    map<string, BDDNode*> getParserSignalBDDs() const { return parser.getSignalBDDs(); }
+
+    // Builds the cofactor with these inputs tied to constants instead of variables.
+    void fixInputs(const map<string, bool>& values) { fixedInputs = values; }
+
     vector<string> getParserInputs() const { return parser.getInputs(); }
     vector<Gate> getParserGates() const { return parser.getGates(); }
 
+    void setSchedulePolicy(SchedulePolicy policy) { schedulePolicy = policy; }
+    // Counting live nodes walks every live BDD after each gate, so it is off by default.
+    void setTrackLiveNodes(bool track) { trackLiveNodes = track; }
+    int getPeakLiveNodes() const { return peakLiveNodes; }
+
+    // Parses the design without evaluating any gate. Each signal is built the first time
+    // getSignalBDD asks for it, evaluating only its cone; results stay memoized in the
+    // parser's signal table, so outputs that are never queried cost nothing. False when the
+    // design cannot be parsed into the current manager.
+    bool prepareLazy(const string& verilogCode) {
+        if (!parser.parse(verilogCode)) return false;
+        applyFixedInputs();
+        lazy = true;
+        startScheduling();
+        prepareCones();
+        return true;
+    }
+
+    // nullptr for signals that are neither inputs nor driven by a gate.
+    BDDNode* getSignalBDD(const string& signal) {
+        if (lazy) {
+            auto it = coneDriver.find(signal);
+            if (it != coneDriver.end() && coneState[it->second] == GATE_PENDING) {
+                PhaseScope phase(PHASE_BUILD);
+                evaluateConeDepthFirst(coneGates, coneDriver, coneState, it->second);
+            }
+        }
+        return parser.getSignalBDD(signal);
+    }
+
+    // Every declared output with its BDD (ZERO when the output is never driven).
+    vector<pair<string, BDDNode*>> getOutputBDDs() {
+        vector<pair<string, BDDNode*>> result;
+        for (const string& out : parser.getOutputs()) {
+            BDDNode* bdd = getSignalBDD(out);
+            result.push_back(make_pair(out, bdd ? bdd : BDD_ZERO));
+        }
+        return result;
+    }
+
     void processGates() {
+        PhaseScope phase(PHASE_BUILD);
+        startScheduling();
+        if (schedulePolicy == SchedulePolicy::Levelized) processGatesLevelized();
+        else processGatesByCone();
+    }
+
+    void processGatesLevelized() {
         vector<Gate> gates = parser.getGates();
         set<string> processedSignals;
 
@@ -325,8 +1013,7 @@ public:
                 }
 
                 if (processedSignals.find(gate.output) == processedSignals.end() && allInputsReady) {
-                    BDDNode* result = evaluateGate(gate);
-                    parser.setSignalBDD(gate.output, result);
+                    commitGate(gate);
                     processedSignals.insert(gate.output);
                     progress = true;
                 }
@@ -336,8 +1023,7 @@ public:
                 // last resort: attempt to process remaining gates anyway
                 for (const Gate& gate : gates) {
                     if (processedSignals.find(gate.output) == processedSignals.end()) {
-                        BDDNode* result = evaluateGate(gate);
-                        parser.setSignalBDD(gate.output, result);
+                        commitGate(gate);
                         processedSignals.insert(gate.output);
                     }
                 }
@@ -346,7 +1032,186 @@ public:
         }
     }
 
+    // Evaluates one output cone at a time (outputs first, then any logic outside every
+    // output cone), so fanin BDDs of a finished cone stop being live early.
+    void processGatesByCone() {
+        prepareCones();
+
+        vector<string> roots = parser.getOutputs();
+        for (const Gate& gate : coneGates) roots.push_back(gate.output);
+
+        for (const string& root : roots) {
+            auto it = coneDriver.find(root);
+            if (it == coneDriver.end() || coneState[it->second] != GATE_PENDING) continue;
+            if (schedulePolicy == SchedulePolicy::DepthFirstCone)
+                evaluateConeDepthFirst(coneGates, coneDriver, coneState, it->second);
+            else
+                evaluateConeMaxFree(coneGates, coneDriver, coneState, it->second);
+        }
+    }
+
+    // Driver map and per-gate state shared by the cone schedules and lazy construction.
+    void prepareCones() {
+        coneGates = parser.getGates();
+        coneDriver.clear();
+        for (size_t i = 0; i < coneGates.size(); ++i) coneDriver.insert(make_pair(coneGates[i].output, i));
+
+        vector<string> inputs = parser.getInputs();
+        set<string> inputSet(inputs.begin(), inputs.end());
+        coneState.assign(coneGates.size(), GATE_PENDING);
+        for (size_t i = 0; i < coneGates.size(); ++i) {
+            if (inputSet.count(coneGates[i].output)) coneState[i] = GATE_DONE;
+        }
+    }
+
+    void evaluateConeDepthFirst(const vector<Gate>& gates, const map<string, size_t>& driver,
+                                vector<GateState>& state, size_t root) {
+        vector<pair<size_t, size_t>> stack;  // gate, next fanin to visit
+        state[root] = GATE_ACTIVE;
+        stack.push_back(make_pair(root, (size_t)0));
+
+        while (!stack.empty()) {
+            size_t g = stack.back().first;
+            if (stack.back().second < gates[g].inputs.size()) {
+                const string& in = gates[g].inputs[stack.back().second++];
+                auto it = driver.find(in);
+                if (it != driver.end() && state[it->second] == GATE_PENDING) {
+                    state[it->second] = GATE_ACTIVE;
+                    stack.push_back(make_pair(it->second, (size_t)0));
+                }
+                continue;
+            }
+            stack.pop_back();
+            commitGate(gates[g]);
+            state[g] = GATE_DONE;
+        }
+    }
+
+    // Within the cone, always evaluates the ready gate that releases the most fanin BDDs;
+    // ties go to the most recently readied gate, which keeps the order depth-first.
+    void evaluateConeMaxFree(const vector<Gate>& gates, const map<string, size_t>& driver,
+                             vector<GateState>& state, size_t root) {
+        vector<size_t> cone;
+        vector<size_t> stack = {root};
+        state[root] = GATE_ACTIVE;
+        while (!stack.empty()) {
+            size_t g = stack.back();
+            stack.pop_back();
+            cone.push_back(g);
+            for (const string& in : gates[g].inputs) {
+                auto it = driver.find(in);
+                if (it != driver.end() && state[it->second] == GATE_PENDING) {
+                    state[it->second] = GATE_ACTIVE;
+                    stack.push_back(it->second);
+                }
+            }
+        }
+
+        map<size_t, int> pendingFanins;
+        map<string, vector<size_t>> consumers;
+        for (size_t g : cone) {
+            set<string> fanins(gates[g].inputs.begin(), gates[g].inputs.end());
+            for (const string& in : fanins) {
+                auto it = driver.find(in);
+                if (it != driver.end() && state[it->second] == GATE_ACTIVE) {
+                    pendingFanins[g]++;
+                    consumers[in].push_back(g);
+                }
+            }
+        }
+
+        vector<size_t> ready;
+        for (auto it = cone.rbegin(); it != cone.rend(); ++it) {
+            if (pendingFanins[*it] == 0) ready.push_back(*it);
+        }
+
+        size_t remaining = cone.size();
+        while (remaining > 0) {
+            if (ready.empty()) {
+                // combinational loop: force the active gate with the fewest pending fanins
+                size_t forced = cone[0];
+                int fewest = -1;
+                for (size_t g : cone) {
+                    if (state[g] == GATE_ACTIVE && (fewest < 0 || pendingFanins[g] < fewest)) {
+                        forced = g;
+                        fewest = pendingFanins[g];
+                    }
+                }
+                ready.push_back(forced);
+            }
+
+            size_t best = ready.size() - 1;
+            int bestFreed = faninsFreedBy(gates[ready[best]]);
+            for (size_t k = ready.size() - 1; k-- > 0;) {
+                int freed = faninsFreedBy(gates[ready[k]]);
+                if (freed > bestFreed) {
+                    best = k;
+                    bestFreed = freed;
+                }
+            }
+
+            size_t g = ready[best];
+            ready.erase(ready.begin() + best);
+            if (state[g] == GATE_DONE) continue;
+
+            commitGate(gates[g]);
+            state[g] = GATE_DONE;
+            --remaining;
+            for (size_t c : consumers[gates[g].output]) {
+                if (state[c] == GATE_ACTIVE && --pendingFanins[c] == 0) ready.push_back(c);
+            }
+        }
+    }
+
+    // Number of distinct fanins whose BDD is dropped once this gate has been evaluated.
+    int faninsFreedBy(const Gate& gate) {
+        set<string> fanins(gate.inputs.begin(), gate.inputs.end());
+        int freed = 0;
+        for (const string& in : fanins) {
+            if (remainingFanout[in] == 1 && !outputSet.count(in)) freed++;
+        }
+        return freed;
+    }
+
+    void startScheduling() {
+        vector<string> outputs = parser.getOutputs();
+        outputSet = set<string>(outputs.begin(), outputs.end());
+        remainingFanout.clear();
+        liveSignals.clear();
+        peakLiveNodes = 0;
+
+        for (const Gate& gate : parser.getGates()) {
+            set<string> fanins(gate.inputs.begin(), gate.inputs.end());
+            for (const string& in : fanins) remainingFanout[in]++;
+        }
+        for (const string& input : parser.getInputs()) {
+            if (remainingFanout[input] > 0 || outputSet.count(input)) liveSignals.insert(input);
+        }
+    }
+
+    // Evaluates a gate and retires fanins that have no consumers left. A signal is live
+    // while some unevaluated gate still reads it or it is an output.
+    void commitGate(const Gate& gate) {
+        parser.setSignalBDD(gate.output, evaluateGate(gate));
+
+        set<string> fanins(gate.inputs.begin(), gate.inputs.end());
+        for (const string& in : fanins) {
+            if (--remainingFanout[in] <= 0 && !outputSet.count(in)) liveSignals.erase(in);
+        }
+        if (remainingFanout[gate.output] > 0 || outputSet.count(gate.output)) liveSignals.insert(gate.output);
+
+        if (trackLiveNodes) {
+            vector<BDDNode*> roots;
+            for (const string& s : liveSignals) {
+                BDDNode* bdd = parser.getSignalBDD(s);
+                if (bdd) roots.push_back(bdd);
+            }
+            peakLiveNodes = max(peakLiveNodes, (int)collectNodes(roots).size() - 2);
+        }
+    }
+
     BDDNode* evaluateGate(const Gate& gate) {
+        PhaseScope phase(PHASE_APPLY);
         if (gate.inputs.empty()) return BDD_ZERO;
 
         if (gate.type == "not" || gate.type == "NOT") {
@@ -387,38 +1252,62 @@ public:
 
 // -------------------------------- Rebuild + Sifting --------------------------------------//
 
-// Rebuild ROBDD using the current variableOrder. Returns the top node.
-BDDNode* rebuildROBDD(const string& verilogCode) {
-    uniqueTable.clear();
-    nodeTable.clear();
+// Frees every node of the current manager; the terminals are shared and stay. BDDs taken
+// before the reset must not be used afterwards. Ids keep increasing, so id-keyed caches
+// never mistake a new node for a freed one.
+void resetBDDTables() {
+    PhaseScope phase(PHASE_GC);
+    clearApplyCache();
+    manager->uniqueTable.clear();
+    for (const auto& entry : manager->nodeTable) delete entry.second;
+    manager->nodeTable.clear();
+}
 
-    // Recreate terminal nodes (note: ids will keep increasing; acceptable for this simple implementation)
-    BDD_ZERO = new BDDNode("0", nullptr, nullptr);
-    BDD_ONE  = new BDDNode("1", nullptr, nullptr);
+// Rebuild ROBDD using the current variableOrder. Returns the top node; `outputs`, when
+// given, receives every output's BDD.
+BDDNode* rebuildROBDD(const string& verilogCode, vector<BDDNode*>* outputs) {
+    resetBDDTables();
 
     ROBDDBuilder builder;
-    return builder.buildROBDD(verilogCode);
+    BDDNode* top = builder.buildROBDD(verilogCode);
+    if (outputs) {
+        outputs->clear();
+        for (const auto& out : builder.getOutputBDDs()) outputs->push_back(out.second);
+    }
+    return top;
 }
 
-// Sifting function: tries moving each variable up/down to find best position.
-void siftVariables(const string& verilogCode) {
-    if (variableOrder.empty()) return;
+// What sifting minimizes. NodeCount is the size of the tables after a rebuild;
+// ExpectedPathLength is the average number of nodes an evaluation of every output visits,
+// which is what the evaluators (images, compact encodings, generated code) pay per query.
+enum class SiftObjective { NodeCount, ExpectedPathLength };
 
-    // Initial build to populate tables
-    rebuildROBDD(verilogCode);
+// Defined with the DAG fold further down.
+double expectedPathLength(const vector<BDDNode*>& roots, const map<string, double>& inputProb);
+
+// Rebuilds with the current order and scores it.
+static double siftCost(const string& verilogCode, SiftObjective objective, const map<string, double>& inputProb) {
+    vector<BDDNode*> outputs;
+    rebuildROBDD(verilogCode, &outputs);
+    if (objective == SiftObjective::ExpectedPathLength) return expectedPathLength(outputs, inputProb);
+    return computeBDDSize();
+}
 
-    for (int i = 0; i < (int)variableOrder.size(); ++i) {
-        string var = variableOrder[i];
+// Sifts every variable of variableOrder[begin, end) to its best position inside that range,
+// starting from an order that scores `cost`. Returns the final cost.
+static double siftRange(const string& verilogCode, int begin, int end, double cost, SiftObjective objective,
+                        const map<string, double>& inputProb) {
+    for (int i = begin; i < end; ++i) {
+        string var = manager->variableOrder[i];
         int bestPosition = i;
-        int minSize = computeBDDSize();
+        double minSize = cost;
 
-        vector<string> originalOrder = variableOrder;
+        vector<string> originalOrder = manager->variableOrder;
 
-        // Move variable up (towards index 0)
-        for (int j = i - 1; j >= 0; --j) {
-            swap(variableOrder[j], variableOrder[j + 1]);
-            rebuildROBDD(verilogCode);
-            int size = computeBDDSize();
+        // Move variable up (towards index begin)
+        for (int j = i - 1; j >= begin; --j) {
+            swap(manager->variableOrder[j], manager->variableOrder[j + 1]);
+            double size = siftCost(verilogCode, objective, inputProb);
             if (size < minSize) {
                 minSize = size;
                 bestPosition = j;
@@ -426,13 +1315,12 @@ void siftVariables(const string& verilogCode) {
         }
 
         // Restore original before downward moves
-        variableOrder = originalOrder;
+        manager->variableOrder = originalOrder;
 
         // Move variable down
-        for (int j = i + 1; j < (int)variableOrder.size(); ++j) {
-            swap(variableOrder[j], variableOrder[j - 1]);
-            rebuildROBDD(verilogCode);
-            int size = computeBDDSize();
+        for (int j = i + 1; j < end; ++j) {
+            swap(manager->variableOrder[j], manager->variableOrder[j - 1]);
+            double size = siftCost(verilogCode, objective, inputProb);
             if (size < minSize) {
                 minSize = size;
                 bestPosition = j;
@@ -440,17 +1328,30 @@ void siftVariables(const string& verilogCode) {
         }
 
         // Place var at bestPosition
-        // If bestPosition == i, no change. Otherwise reinsert.
+        // If bestPosition == i, no change. Otherwise reinsert into the original order (the
+        // downward moves left var at the bottom of the range).
+        manager->variableOrder = originalOrder;
         if (bestPosition != i) {
-            variableOrder.erase(variableOrder.begin() + i);
-            variableOrder.insert(variableOrder.begin() + bestPosition, var);
+            manager->variableOrder.erase(manager->variableOrder.begin() + i);
+            manager->variableOrder.insert(manager->variableOrder.begin() + bestPosition, var);
             // rebuild at chosen position
             rebuildROBDD(verilogCode);
-        } else {
-            // restore original if unchanged
-            variableOrder = originalOrder;
         }
+        cost = minSize;
     }
+    return cost;
+}
+
+// Sifting function: tries moving each variable up/down to find best position. Inputs
+// missing from inputProb are 1 with probability 0.5 (ExpectedPathLength only).
+void siftVariables(const string& verilogCode, SiftObjective objective = SiftObjective::NodeCount,
+                   const map<string, double>& inputProb = map<string, double>()) {
+    if (manager->variableOrder.empty()) return;
+    PhaseScope phase(PHASE_SIFT);
+
+    // Initial build to populate tables
+    double cost = siftCost(verilogCode, objective, inputProb);
+    siftRange(verilogCode, 0, (int)manager->variableOrder.size(), cost, objective, inputProb);
 }
 
 // -------------------------------- BDD Printer --------------------------------------//
@@ -472,39 +1373,5233 @@ void printBDD(BDDNode* node, const string& indent = "", bool isLast = true) {
     printBDD(node->high, newIndent, true);
 }
 
-// -------------------------------- Main --------------------------------------//
-int main() {
-    cout << "Enter combinational Verilog design (end with 'endmodule'):" << endl;
+// -------------------------------- Node Collection --------------------------------------//
+// Traversals mark nodes with a per-thread epoch instead of keeping a visited set, and
+// record each node's position in the result so that per-node data can live in flat arrays.
+// The marks are only meaningful until the next traversal on the same thread.
 
-    string line;
-    string verilogCode;
+thread_local uint32_t foldEpoch = 0;
 
-    while (getline(cin, line)) {
-        verilogCode += line + "\n";
-        if (line.find("endmodule") != string::npos) break;
+static uint32_t nextFoldEpoch() {
+    if (++foldEpoch == 0) {
+        // Wrapped around: clear stale marks so that no node looks visited.
+        for (auto& entry : manager->nodeTable) entry.second->foldMark = 0;
+        BDD_ZERO->foldMark = BDD_ONE->foldMark = 0;
+        foldEpoch = 1;
     }
+    return foldEpoch;
+}
 
-    // Initialize terminal nodes and tables
-    uniqueTable.clear();
-    nodeTable.clear();
-    BDD_ZERO = new BDDNode("0", nullptr, nullptr);
-    BDD_ONE  = new BDDNode("1", nullptr, nullptr);
+// Returns every node reachable from the roots with children ahead of their parents.
+// The terminals always come first: index 0 is ZERO, index 1 is ONE. Afterwards
+// node->foldIndex is the node's index in the returned vector.
+vector<BDDNode*> collectNodes(const vector<BDDNode*>& roots) {
+    uint32_t epoch = nextFoldEpoch();
+    vector<BDDNode*> order = {BDD_ZERO, BDD_ONE};
+    BDD_ZERO->foldMark = BDD_ONE->foldMark = epoch;
+    BDD_ZERO->foldIndex = 0;
+    BDD_ONE->foldIndex = 1;
+    vector<pair<BDDNode*, bool>> stack;
 
-    // Perform sifting to optimize variable order and build final ROBDD
-    siftVariables(verilogCode);
+    for (BDDNode* root : roots) {
+        if (root) stack.push_back(make_pair(root, false));
+        while (!stack.empty()) {
+            BDDNode* node = stack.back().first;
+            bool expanded = stack.back().second;
+            stack.pop_back();
+
+            if (expanded) {
+                node->foldIndex = (uint32_t)order.size();
+                order.push_back(node);
+                continue;
+            }
+            if (node->foldMark == epoch) continue;
+            node->foldMark = epoch;
+
+            stack.push_back(make_pair(node, true));
+            stack.push_back(make_pair(node->high, false));
+            stack.push_back(make_pair(node->low, false));
+        }
+    }
+    return order;
+}
+
+// -------------------------------- DAG Fold --------------------------------------//
+// Bottom-up evaluation of leafFn(value) at the terminals and nodeFn(node, level, low, high)
+// at every inner node, each node computed once however many parents or roots share it.
+// With FoldPolicy::LevelParallel every level is split across threads (a level only reads
+// deeper ones), so nodeFn must then be safe to call concurrently. The workers see
+// mainManager, not necessarily the caller's manager, which is why levels are resolved up
+// front and passed in: nodeFn must not look anything up in the manager itself.
+
+class LevelBarrier {
+private:
+    mutex m;
+    condition_variable cv;
+    int count;
+    int waiting = 0;
+    unsigned generation = 0;
+
+public:
+    explicit LevelBarrier(int n) : count(n) {}
+
+    void wait() {
+        unique_lock<mutex> lock(m);
+        unsigned gen = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            ++generation;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    }
+};
+
+// Set from a tuning profile; 0 leaves the count to the hardware.
+int threadCountOverride = 0;
+
+int defaultThreadCount() {
+    if (threadCountOverride > 0) return threadCountOverride;
+    unsigned hw = thread::hardware_concurrency();
+    return hw == 0 ? 1 : (int)hw;
+}
+
+// Below this many nodes the threads cost more than they save.
+const size_t PARALLEL_PASS_MIN_NODES = 4096;
+
+enum class FoldPolicy { Sequential, LevelParallel };
+
+template <class Result>
+struct BDDFold {
+    vector<BDDNode*> nodes;      // children first; 0 = ZERO, 1 = ONE
+    vector<Result> values;       // values[i] belongs to nodes[i]
+    vector<Result> rootValues;   // one per root, in the order given
+    vector<int> levels;          // levels[i] is the level of nodes[i]; terminals sit at #vars
+
+    const Result& operator[](BDDNode* node) const { return values[node->foldIndex]; }
+};
+
+template <class Result, class LeafFn, class NodeFn>
+BDDFold<Result> foldBDD(const vector<BDDNode*>& roots, LeafFn leafFn, NodeFn nodeFn,
+                        FoldPolicy policy = FoldPolicy::Sequential, int numThreads = 0) {
+    // vector<bool> packs bits, so neighbouring nodes would race in the parallel policy.
+    static_assert(!is_same<Result, bool>::value, "fold to char instead of bool");
+
+    BDDFold<Result> fold;
+    fold.nodes = collectNodes(roots);
+    fold.values.resize(fold.nodes.size());
+    fold.values[0] = leafFn(false);
+    fold.values[1] = leafFn(true);
+    fold.levels.assign(fold.nodes.size(), (int)manager->variableOrder.size());
+    for (uint32_t i = 2; i < fold.nodes.size(); ++i) fold.levels[i] = getVariableIndex(fold.nodes[i]->variable);
+
+    auto evaluate = [&](uint32_t i) {
+        BDDNode* n = fold.nodes[i];
+        fold.values[i] = nodeFn(n, fold.levels[i], fold.values[n->low->foldIndex], fold.values[n->high->foldIndex]);
+    };
+
+    if (numThreads <= 0) numThreads = defaultThreadCount();
+    if (policy == FoldPolicy::Sequential || fold.nodes.size() < PARALLEL_PASS_MIN_NODES) numThreads = 1;
+
+    if (numThreads == 1) {
+        for (uint32_t i = 2; i < fold.nodes.size(); ++i) evaluate(i);
+    } else {
+        vector<vector<uint32_t>> levels(manager->variableOrder.size());
+        for (uint32_t i = 2; i < fold.nodes.size(); ++i) levels[fold.levels[i]].push_back(i);
+
+        auto worker = [&](int t, LevelBarrier* barrier) {
+            for (int level = (int)levels.size() - 1; level >= 0; --level) {
+                const vector<uint32_t>& nodes = levels[level];
+                for (size_t k = (size_t)t; k < nodes.size(); k += (size_t)numThreads) evaluate(nodes[k]);
+                barrier->wait();
+            }
+        };
+
+        LevelBarrier barrier(numThreads);
+        vector<thread> threads;
+        for (int t = 1; t < numThreads; ++t) threads.emplace_back(worker, t, &barrier);
+        worker(0, &barrier);
+        for (thread& th : threads) th.join();
+    }
+
+    for (BDDNode* root : roots) fold.rootValues.push_back(fold.values[root ? root->foldIndex : 0]);
+    return fold;
+}
+
+// Fewest variable tests on a path from f to ONE; -1 when f is unsatisfiable.
+int shortestSatisfyingPath(BDDNode* f) {
+    auto leaf = [](bool value) { return value ? 0 : -1; };
+    auto node = [](BDDNode*, int, int low, int high) {
+        if (low < 0) return high < 0 ? -1 : high + 1;
+        return high < 0 ? low + 1 : min(low, high) + 1;
+    };
+    return foldBDD<int>({f}, leaf, node).rootValues[0];
+}
+
+// Expected number of inner nodes visited when evaluating every root once, with the
+// variable at each level being 1 with its inputProb probability (0.5 when missing).
+double expectedPathLength(const vector<BDDNode*>& roots, const map<string, double>& inputProb) {
+    vector<double> levelProb(manager->variableOrder.size(), 0.5);
+    for (size_t l = 0; l < manager->variableOrder.size(); ++l) {
+        auto it = inputProb.find(manager->variableOrder[l]);
+        if (it != inputProb.end()) levelProb[l] = it->second;
+    }
+
+    auto leaf = [](bool) { return 0.0; };
+    auto node = [&](BDDNode*, int level, double low, double high) {
+        double q = levelProb[level];
+        return 1.0 + (1.0 - q) * low + q * high;
+    };
+    double total = 0;
+    for (double length : foldBDD<double>(roots, leaf, node).rootValues) total += length;
+    return total;
+}
+
+// -------------------------------- Shared BDD Image --------------------------------------//
+// A flat, pointer-free copy of a multi-root BDD. Children are indices into the node array,
+// so the same bytes can be written to a file or POSIX shared memory and mapped read-only
+// at any address by any number of processes, with no deserialization step.
+//
+// Layout: header | nodes[numNodes] | roots[numRoots] | nameOffsets[numVars + numRoots] | pool
+// Nodes are stored children-first; index 0 is ZERO and index 1 is ONE.
+
+const uint32_t BDD_IMAGE_MAGIC   = 0x49444252; // "RBDI" in little-endian byte order
+const uint32_t BDD_IMAGE_VERSION = 1;
+
+struct BDDImageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numVars;
+    uint32_t numNodes;
+    uint32_t numRoots;
+    uint32_t reserved;
+    uint64_t nodesOffset;
+    uint64_t rootsOffset;
+    uint64_t namesOffset;
+    uint64_t totalSize;
+};
+
+struct BDDImageNode {
+    uint32_t level;   // numVars for the terminals
+    uint32_t low;
+    uint32_t high;
+};
+
+struct BDDImageView {
+    const BDDImageHeader* header = nullptr;
+    const BDDImageNode* nodes = nullptr;
+    const uint32_t* roots = nullptr;
+    const uint32_t* nameOffsets = nullptr;
+    const char* namePool = nullptr;
+    void* mapping = nullptr;   // set when the view owns an mmap'ed region
+    size_t mappedSize = 0;
+
+    bool valid() const { return header != nullptr; }
+    const char* varName(uint32_t level) const { return namePool + nameOffsets[level]; }
+    const char* rootName(uint32_t r) const { return namePool + nameOffsets[header->numVars + r]; }
+};
+
+static uint64_t alignImageOffset(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+vector<char> serializeBDDImage(const vector<BDDNode*>& roots, const vector<string>& rootNames) {
+    vector<BDDNode*> nodes = collectNodes(roots);
+    map<int, uint32_t> indexOf;
+    for (size_t i = 0; i < nodes.size(); ++i) indexOf[nodes[i]->id] = (uint32_t)i;
+
+    vector<string> names = manager->variableOrder;
+    for (size_t r = 0; r < roots.size(); ++r) names.push_back(r < rootNames.size() ? rootNames[r] : "");
+    uint64_t poolSize = 0;
+    for (const string& name : names) poolSize += name.size() + 1;
+
+    BDDImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BDD_IMAGE_MAGIC;
+    header.version = BDD_IMAGE_VERSION;
+    header.numVars = (uint32_t)manager->variableOrder.size();
+    header.numNodes = (uint32_t)nodes.size();
+    header.numRoots = (uint32_t)roots.size();
+    header.nodesOffset = sizeof(BDDImageHeader);
+    header.rootsOffset = alignImageOffset(header.nodesOffset + nodes.size() * sizeof(BDDImageNode));
+    header.namesOffset = alignImageOffset(header.rootsOffset + roots.size() * sizeof(uint32_t));
+    header.totalSize = alignImageOffset(header.namesOffset + names.size() * sizeof(uint32_t) + poolSize);
+
+    vector<char> image(header.totalSize, 0);
+    memcpy(image.data(), &header, sizeof(header));
+
+    BDDImageNode* out = reinterpret_cast<BDDImageNode*>(image.data() + header.nodesOffset);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (isTerminal(nodes[i])) {
+            out[i].level = header.numVars;
+            out[i].low = out[i].high = (uint32_t)i;
+            continue;
+        }
+        out[i].level = (uint32_t)getVariableIndex(nodes[i]->variable);
+        out[i].low = indexOf[nodes[i]->low->id];
+        out[i].high = indexOf[nodes[i]->high->id];
+    }
+
+    uint32_t* rootOut = reinterpret_cast<uint32_t*>(image.data() + header.rootsOffset);
+    for (size_t r = 0; r < roots.size(); ++r) rootOut[r] = roots[r] ? indexOf[roots[r]->id] : 0;
+
+    uint32_t* nameOut = reinterpret_cast<uint32_t*>(image.data() + header.namesOffset);
+    char* pool = image.data() + header.namesOffset + names.size() * sizeof(uint32_t);
+    uint32_t poolPos = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        nameOut[i] = poolPos;
+        memcpy(pool + poolPos, names[i].c_str(), names[i].size() + 1);
+        poolPos += (uint32_t)names[i].size() + 1;
+    }
+    return image;
+}
+
+// Wraps an image that is already in memory. The header, every node and root index and the
+// name table are checked once here, in one pass over the node array, so evaluation can
+// trust them: inner nodes have a level below numVars and children below their own index,
+// which also rules out cycles.
+BDDImageView viewBDDImage(const void* data, size_t size) {
+    BDDImageView view;
+    if (!data || size < sizeof(BDDImageHeader)) return view;
+
+    const char* base = static_cast<const char*>(data);
+    const BDDImageHeader* header = reinterpret_cast<const BDDImageHeader*>(base);
+    if (header->magic != BDD_IMAGE_MAGIC || header->version != BDD_IMAGE_VERSION) return view;
+    if (header->totalSize > size || header->numNodes < 2) return view;
+    if (header->nodesOffset < sizeof(BDDImageHeader) || header->nodesOffset % 8 != 0 || header->rootsOffset % 8 != 0 ||
+        header->namesOffset % 8 != 0 || header->namesOffset > header->totalSize)
+        return view;
+    if (header->nodesOffset + (uint64_t)header->numNodes * sizeof(BDDImageNode) > header->rootsOffset) return view;
+    if (header->rootsOffset + (uint64_t)header->numRoots * sizeof(uint32_t) > header->namesOffset) return view;
+    uint64_t poolOffset = header->namesOffset + ((uint64_t)header->numVars + header->numRoots) * sizeof(uint32_t);
+    if (poolOffset > header->totalSize) return view;
+    if (poolOffset < header->totalSize && base[header->totalSize - 1] != '\0') return view;
+
+    const BDDImageNode* nodes = reinterpret_cast<const BDDImageNode*>(base + header->nodesOffset);
+    for (uint32_t i = 0; i < header->numNodes; ++i) {
+        if (i < 2) {
+            if (nodes[i].level != header->numVars) return view;
+        } else if (nodes[i].level >= header->numVars || nodes[i].low >= i || nodes[i].high >= i) {
+            return view;
+        }
+    }
+    const uint32_t* roots = reinterpret_cast<const uint32_t*>(base + header->rootsOffset);
+    for (uint32_t r = 0; r < header->numRoots; ++r) {
+        if (roots[r] >= header->numNodes) return view;
+    }
+    const uint32_t* nameOffsets = reinterpret_cast<const uint32_t*>(base + header->namesOffset);
+    for (uint64_t n = 0; n < (uint64_t)header->numVars + header->numRoots; ++n) {
+        if (nameOffsets[n] >= header->totalSize - poolOffset) return view;
+    }
+
+    view.header = header;
+    view.nodes = nodes;
+    view.roots = roots;
+    view.nameOffsets = nameOffsets;
+    view.namePool = base + poolOffset;
+    return view;
+}
+
+static bool writeAllBytes(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) return false;
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+static bool writeImageToFd(int fd, const vector<BDDNode*>& roots, const vector<string>& rootNames) {
+    vector<char> image = serializeBDDImage(roots, rootNames);
+    if (ftruncate(fd, (off_t)image.size()) != 0) return false;
+    return writeAllBytes(fd, image.data(), image.size());
+}
+
+bool writeBDDImageFile(const string& path, const vector<BDDNode*>& roots, const vector<string>& rootNames) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeImageToFd(fd, roots, rootNames);
+    close(fd);
+    return ok;
+}
+
+// shmName follows shm_open rules, e.g. "/robdd_design".
+bool writeBDDImageShm(const string& shmName, const vector<BDDNode*>& roots, const vector<string>& rootNames) {
+    int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeImageToFd(fd, roots, rootNames);
+    close(fd);
+    return ok;
+}
+
+static BDDImageView mapBDDImageFd(int fd) {
+    BDDImageView view;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) return view;
+
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) return view;
+
+    view = viewBDDImage(mapping, (size_t)st.st_size);
+    if (!view.valid()) {
+        munmap(mapping, (size_t)st.st_size);
+        return view;
+    }
+    view.mapping = mapping;
+    view.mappedSize = (size_t)st.st_size;
+    return view;
+}
+
+BDDImageView mapBDDImageFile(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return BDDImageView();
+    BDDImageView view = mapBDDImageFd(fd);
+    close(fd);
+    return view;
+}
+
+BDDImageView mapBDDImageShm(const string& shmName) {
+    int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+    if (fd < 0) return BDDImageView();
+    BDDImageView view = mapBDDImageFd(fd);
+    close(fd);
+    return view;
+}
+
+void unmapBDDImage(BDDImageView& view) {
+    if (view.mapping) munmap(view.mapping, view.mappedSize);
+    view = BDDImageView();
+}
+
+int findImageRoot(const BDDImageView& view, const string& name) {
+    for (uint32_t r = 0; r < view.header->numRoots; ++r) {
+        if (name == view.rootName(r)) return (int)r;
+    }
+    return -1;
+}
+
+// levelValues[i] is the value of the variable at level i of the image. Fails when root is
+// not below numRoots or levelValues holds fewer than numVars values.
+bool evaluateImage(const BDDImageView& view, uint32_t root, const vector<bool>& levelValues, bool& value) {
+    if (root >= view.header->numRoots || levelValues.size() < view.header->numVars) return false;
+    uint32_t index = view.roots[root];
+    while (index > 1) {
+        const BDDImageNode& node = view.nodes[index];
+        index = levelValues[node.level] ? node.high : node.low;
+    }
+    value = index == 1;
+    return true;
+}
+
+// -------------------------------- Compact BDD Encoding --------------------------------------//
+// Compressed, level-grouped encoding for archived and frozen BDDs. Nodes are numbered from
+// the deepest level upwards, so both children of node i have smaller indices, and within a
+// level they are sorted by (low, high). Children are LEB128 varints. Every
+// COMPACT_CHECKPOINT_STRIDE-th node of a block gets a byte-offset checkpoint and stores
+// its children against its own index: 0 and 1 for the terminals (0 = ZERO, 1 = ONE), and
+// (i - child) + 1 for inner nodes. The nodes after it store the difference to the
+// previous node's children, the low one plain (the sort makes it non-negative) and the
+// high one zigzag-coded. Levels are implied by the block a node sits in. Random access and
+// in-place evaluation decode at most one checkpoint stride.
+
+const uint32_t COMPACT_CHECKPOINT_STRIDE = 16;
+const uint32_t COMPACT_MAGIC = 0x32444252; // "RBD2"
+
+struct CompactLevelBlock {
+    uint32_t level;
+    uint32_t firstIndex;
+    uint32_t count;
+    uint32_t firstCheckpoint;  // index into CompactBDD::checkpoints
+    uint64_t byteOffset;       // start of the block in CompactBDD::bytes
+};
+
+struct CompactNode {
+    uint32_t level;
+    uint32_t low;
+    uint32_t high;
+};
+
+struct CompactBDD {
+    vector<string> varNames;           // level -> variable
+    vector<CompactLevelBlock> blocks;  // deepest level first, only non-empty levels
+    vector<uint32_t> checkpoints;      // byte offset relative to the owning block
+    vector<uint8_t> bytes;
+    vector<uint32_t> roots;
+
+    uint32_t numNodes() const {
+        return blocks.empty() ? 2 : blocks.back().firstIndex + blocks.back().count;
+    }
+    size_t encodedSize() const {
+        return bytes.size() + checkpoints.size() * sizeof(uint32_t) +
+               blocks.size() * sizeof(CompactLevelBlock) + roots.size() * sizeof(uint32_t);
+    }
+};
+
+static void putVarint(vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// For encodings built in memory or already validated by readCompactBDDFile.
+static uint32_t getVarint(const uint8_t*& p) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= (uint32_t)(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= (uint32_t)(*p++) << shift;
+    return value;
+}
+
+// For untrusted input: fails on a varint that runs past end or does not fit 32 bits.
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (p >= end) return false;
+        uint8_t byte = *p++;
+        if (shift == 28 && byte > 0x0f) return false;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void putCompactChild(vector<uint8_t>& out, uint32_t index, uint32_t child) {
+    putVarint(out, child < 2 ? child : index - child + 1);
+}
+
+static uint32_t compactChild(uint32_t index, uint32_t code) {
+    return code < 2 ? code : index - (code - 1);
+}
+
+static uint32_t zigzag(int64_t value) {
+    return (uint32_t)(value < 0 ? -2 * value - 1 : 2 * value);
+}
+
+static int64_t unzigzag(uint32_t code) {
+    return (code & 1) ? -(int64_t)(code >> 1) - 1 : (int64_t)(code >> 1);
+}
+
+// Children of node k of a block, given the previous node's children (ignored at checkpoints).
+static void getCompactChildren(const uint8_t*& p, uint32_t index, uint32_t k, uint32_t& low, uint32_t& high) {
+    uint32_t lowCode = getVarint(p);
+    uint32_t highCode = getVarint(p);
+    if (k % COMPACT_CHECKPOINT_STRIDE == 0) {
+        low = compactChild(index, lowCode);
+        high = compactChild(index, highCode);
+    } else {
+        low += lowCode;
+        high = (uint32_t)((int64_t)high + unzigzag(highCode));
+    }
+}
+
+CompactBDD compressBDD(const vector<BDDNode*>& roots) {
+    CompactBDD result;
+    result.varNames = manager->variableOrder;
+
+    int numVars = (int)manager->variableOrder.size();
+    vector<vector<BDDNode*>> byLevel(numVars);
+    for (BDDNode* node : collectNodes(roots)) {
+        if (!isTerminal(node)) byLevel[getVariableIndex(node->variable)].push_back(node);
+    }
+
+    map<int, uint32_t> indexOf;
+    indexOf[BDD_ZERO->id] = 0;
+    indexOf[BDD_ONE->id] = 1;
+    uint32_t next = 2;
+
+    for (int level = numVars - 1; level >= 0; --level) {
+        if (byLevel[level].empty()) continue;
+        sort(byLevel[level].begin(), byLevel[level].end(), [&](BDDNode* a, BDDNode* b) {
+            return make_pair(indexOf[a->low->id], indexOf[a->high->id]) < make_pair(indexOf[b->low->id], indexOf[b->high->id]);
+        });
+
+        CompactLevelBlock block;
+        block.level = (uint32_t)level;
+        block.firstIndex = next;
+        block.count = (uint32_t)byLevel[level].size();
+        block.firstCheckpoint = (uint32_t)result.checkpoints.size();
+        block.byteOffset = result.bytes.size();
+
+        uint32_t prevLow = 0, prevHigh = 0;
+        for (uint32_t k = 0; k < block.count; ++k) {
+            BDDNode* node = byLevel[level][k];
+            uint32_t index = next++;
+            uint32_t low = indexOf[node->low->id];
+            uint32_t high = indexOf[node->high->id];
+            indexOf[node->id] = index;
+            if (k % COMPACT_CHECKPOINT_STRIDE == 0) {
+                result.checkpoints.push_back((uint32_t)(result.bytes.size() - block.byteOffset));
+                putCompactChild(result.bytes, index, low);
+                putCompactChild(result.bytes, index, high);
+            } else {
+                putVarint(result.bytes, low - prevLow);
+                putVarint(result.bytes, zigzag((int64_t)high - (int64_t)prevHigh));
+            }
+            prevLow = low;
+            prevHigh = high;
+        }
+        result.blocks.push_back(block);
+    }
+
+    for (BDDNode* root : roots) result.roots.push_back(root ? indexOf[root->id] : 0);
+    return result;
+}
+
+// Index of the block holding node index (index >= 2).
+static size_t findCompactBlock(const CompactBDD& c, uint32_t index) {
+    size_t lo = 0, hi = c.blocks.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (c.blocks[mid].firstIndex <= index) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+CompactNode decodeCompactNode(const CompactBDD& c, uint32_t index) {
+    if (index < 2) return CompactNode{(uint32_t)c.varNames.size(), index, index};
+
+    const CompactLevelBlock& block = c.blocks[findCompactBlock(c, index)];
+    uint32_t k = index - block.firstIndex;
+    uint32_t checkpoint = k - k % COMPACT_CHECKPOINT_STRIDE;
+    const uint8_t* p = c.bytes.data() + block.byteOffset +
+                       c.checkpoints[block.firstCheckpoint + k / COMPACT_CHECKPOINT_STRIDE];
+    uint32_t low = 0, high = 0;
+    for (uint32_t j = checkpoint; j <= k; ++j) getCompactChildren(p, block.firstIndex + j, j, low, high);
+    return CompactNode{block.level, low, high};
+}
+
+// Decodes one level block on its own; blocks are independent of each other.
+vector<CompactNode> decodeCompactBlock(const CompactBDD& c, size_t blockIndex) {
+    const CompactLevelBlock& block = c.blocks[blockIndex];
+    vector<CompactNode> nodes;
+    nodes.reserve(block.count);
+    const uint8_t* p = c.bytes.data() + block.byteOffset;
+    uint32_t low = 0, high = 0;
+    for (uint32_t k = 0; k < block.count; ++k) {
+        getCompactChildren(p, block.firstIndex + k, k, low, high);
+        nodes.push_back(CompactNode{block.level, low, high});
+    }
+    return nodes;
+}
+
+// levelValues[i] is the value of the variable at level i of the encoding.
+bool evaluateCompact(const CompactBDD& c, uint32_t root, const vector<bool>& levelValues) {
+    uint32_t index = c.roots[root];
+    while (index > 1) {
+        CompactNode node = decodeCompactNode(c, index);
+        index = levelValues[node.level] ? node.high : node.low;
+    }
+    return index == 1;
+}
+
+// Rebuilds the encoded roots in the current manager. Fails, building nothing, unless the
+// current variable order is the one the BDD was compressed under.
+bool decompressBDD(const CompactBDD& c, vector<BDDNode*>& roots) {
+    if (c.varNames != manager->variableOrder) return false;
+    vector<BDDNode*> nodes = {BDD_ZERO, BDD_ONE};
+    nodes.reserve(c.numNodes());
+    for (size_t b = 0; b < c.blocks.size(); ++b) {
+        for (const CompactNode& n : decodeCompactBlock(c, b))
+            nodes.push_back(makeNode(c.varNames[n.level], nodes[n.low], nodes[n.high]));
+    }
+
+    roots.clear();
+    for (uint32_t r : c.roots) roots.push_back(nodes[r]);
+    return true;
+}
+
+static void putRaw32(vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+static uint32_t getRaw32(const uint8_t*& p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= (uint32_t)(*p++) << (8 * i);
+    return value;
+}
+
+bool writeCompactBDDFile(const string& path, const CompactBDD& c) {
+    vector<uint8_t> out;
+    putRaw32(out, COMPACT_MAGIC);
+    putRaw32(out, (uint32_t)c.varNames.size());
+    for (const string& name : c.varNames) {
+        putVarint(out, (uint32_t)name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+    putVarint(out, (uint32_t)c.blocks.size());
+    for (const CompactLevelBlock& b : c.blocks) {
+        putVarint(out, b.level);
+        putVarint(out, b.count);
+    }
+    putVarint(out, (uint32_t)c.roots.size());
+    for (uint32_t r : c.roots) putVarint(out, r);
+    putRaw32(out, (uint32_t)c.bytes.size());
+    out.insert(out.end(), c.bytes.begin(), c.bytes.end());
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAllBytes(fd, reinterpret_cast<const char*>(out.data()), out.size());
+    close(fd);
+    return ok;
+}
+
+// Block offsets and checkpoints are not stored; they are recomputed with one scan. The
+// file is untrusted: every count is bounded by the bytes left, levels must be known and
+// strictly rising towards the root, and every child must lie in a deeper block, so a
+// successful read decodes and evaluates without further checks.
+bool readCompactBDDFile(const string& path, CompactBDD& c) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    vector<uint8_t> in;
+    uint8_t chunk[1 << 16];
+    while (true) {
+        ssize_t got = read(fd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            close(fd);
+            if (got < 0) return false;
+            break;
+        }
+        in.insert(in.end(), chunk, chunk + got);
+    }
+    if (in.size() < 8) return false;
+
+    const uint8_t* p = in.data();
+    const uint8_t* end = in.data() + in.size();
+    if (getRaw32(p) != COMPACT_MAGIC) return false;
+
+    c = CompactBDD();
+    uint32_t numVars = getRaw32(p);
+    if (numVars > (size_t)(end - p)) return false;  // every name takes at least a length byte
+    c.varNames.resize(numVars);
+    for (string& name : c.varNames) {
+        uint32_t len;
+        if (!getVarint(p, end, len) || len > (size_t)(end - p)) return false;
+        name.assign(reinterpret_cast<const char*>(p), len);
+        p += len;
+    }
+
+    uint32_t numBlocks;
+    if (!getVarint(p, end, numBlocks) || numBlocks > numVars) return false;
+    c.blocks.resize(numBlocks);
+    uint64_t next = 2;
+    for (size_t i = 0; i < c.blocks.size(); ++i) {
+        CompactLevelBlock& b = c.blocks[i];
+        if (!getVarint(p, end, b.level) || !getVarint(p, end, b.count)) return false;
+        if (b.level >= numVars || b.count == 0 || (i > 0 && b.level >= c.blocks[i - 1].level)) return false;
+        b.firstIndex = (uint32_t)next;
+        next += b.count;
+        if (next > UINT32_MAX) return false;
+    }
+
+    uint32_t numRoots;
+    if (!getVarint(p, end, numRoots) || numRoots > (size_t)(end - p)) return false;
+    c.roots.resize(numRoots);
+    for (uint32_t& r : c.roots) {
+        if (!getVarint(p, end, r) || r >= next) return false;
+    }
+    if ((size_t)(end - p) < 4) return false;
+    uint32_t numBytes = getRaw32(p);
+    if ((size_t)(end - p) != numBytes || (next - 2) * 2 > numBytes) return false;
+    c.bytes.assign(p, end);
+
+    const uint8_t* q = c.bytes.data();
+    const uint8_t* bytesEnd = q + c.bytes.size();
+    for (CompactLevelBlock& b : c.blocks) {
+        b.byteOffset = (uint64_t)(q - c.bytes.data());
+        b.firstCheckpoint = (uint32_t)c.checkpoints.size();
+        int64_t low = 0, high = 0;
+        for (uint32_t k = 0; k < b.count; ++k) {
+            uint32_t index = b.firstIndex + k;
+            if (k % COMPACT_CHECKPOINT_STRIDE == 0)
+                c.checkpoints.push_back((uint32_t)(q - c.bytes.data() - b.byteOffset));
+            uint32_t lowCode, highCode;
+            if (!getVarint(q, bytesEnd, lowCode) || !getVarint(q, bytesEnd, highCode)) return false;
+            if (k % COMPACT_CHECKPOINT_STRIDE == 0) {
+                if ((lowCode >= 2 && lowCode - 1 > index) || (highCode >= 2 && highCode - 1 > index)) return false;
+                low = compactChild(index, lowCode);
+                high = compactChild(index, highCode);
+            } else {
+                low += lowCode;
+                high += unzigzag(highCode);
+            }
+            if (low < 0 || high < 0 || low >= b.firstIndex || high >= b.firstIndex) return false;
+        }
+    }
+    return q == bytesEnd;
+}
+
+// -------------------------------- Parallel Satcount / Probability --------------------------------------//
+// Both are level-parallel folds. LevelizedBDD keeps the same dense, children-first
+// numbering with explicit child indices and per-level buckets for passes that need them.
+
+struct LevelizedBDD {
+    vector<BDDNode*> nodes;           // dense index -> node; 0 = ZERO, 1 = ONE
+    vector<uint32_t> low;
+    vector<uint32_t> high;
+    vector<vector<uint32_t>> levels;  // level -> dense indices of the nodes on it
+    vector<uint32_t> roots;
+};
+
+LevelizedBDD levelizeBDD(const vector<BDDNode*>& roots) {
+    LevelizedBDD result;
+    result.nodes = collectNodes(roots);
+    result.levels.resize(manager->variableOrder.size());
+
+    result.low.resize(result.nodes.size());
+    result.high.resize(result.nodes.size());
+    for (size_t i = 0; i < result.nodes.size(); ++i) {
+        BDDNode* node = result.nodes[i];
+        if (isTerminal(node)) {
+            result.low[i] = result.high[i] = (uint32_t)i;
+            continue;
+        }
+        result.low[i] = node->low->foldIndex;
+        result.high[i] = node->high->foldIndex;
+        result.levels[getVariableIndex(node->variable)].push_back((uint32_t)i);
+    }
+    for (BDDNode* root : roots) result.roots.push_back(root ? root->foldIndex : 0);
+    return result;
+}
+
+// Output probability of every root when the variable at each level is 1 with the given
+// probability; inputs missing from inputProb default to 0.5.
+vector<double> parallelProbability(const vector<BDDNode*>& roots, const map<string, double>& inputProb,
+                                   int numThreads = 0) {
+    vector<double> levelProb(manager->variableOrder.size(), 0.5);
+    for (size_t l = 0; l < manager->variableOrder.size(); ++l) {
+        auto it = inputProb.find(manager->variableOrder[l]);
+        if (it != inputProb.end()) levelProb[l] = it->second;
+    }
+
+    auto leaf = [](bool value) { return value ? 1.0 : 0.0; };
+    auto node = [&](BDDNode*, int level, double low, double high) {
+        double q = levelProb[level];
+        return (1.0 - q) * low + q * high;
+    };
+    return foldBDD<double>(roots, leaf, node, FoldPolicy::LevelParallel, numThreads).rootValues;
+}
+
+// Number of satisfying assignments over all variables in variableOrder. Doubles keep
+// the count exact up to 2^53 and representable up to about 1000 variables.
+vector<double> parallelSatCount(const vector<BDDNode*>& roots, int numThreads = 0) {
+    vector<double> result = parallelProbability(roots, map<string, double>(), numThreads);
+    double scale = ldexp(1.0, (int)manager->variableOrder.size());
+    for (double& r : result) r *= scale;
+    return result;
+}
+
+// -------------------------------- Variable Marginals and Sensitivity --------------------------------------//
+// Statistics of every input variable at once: one upward fold gives the probability that
+// the function below each node is 1, and one downward pass per output gives the
+// probability that an evaluation reaches each node. A variable at level l is either
+// tested by a node on l or jumped over by an edge; the mass on jumping edges is added to
+// all the levels they skip through a difference array, so both passes stay linear.
+//
+// The influence of x sums, over the nodes on x's level, the reach times P(low != high);
+// jumping edges add nothing since f does not depend on x there. P(low != high) comes from
+// a recursion over node pairs memoized across the whole call, so it is linear only when
+// few pairs meet, but it never allocates BDD nodes.
+
+struct VariableSensitivity {
+    string variable;
+    double marginal = 0;   // P(x = 1 | f = 1); 0 when f is unsatisfiable
+    double birnbaum = 0;   // P(f | x = 1) - P(f | x = 0)
+    double influence = 0;  // P(f|x=1 != f|x=0), the p-biased Banzhaf influence
+};
+
+// P(g != h) for two nodes of `up`, whose levels and probabilities it supplies.
+static double differenceProbability(BDDNode* g, BDDNode* h, const BDDFold<double>& up,
+                                    const vector<double>& levelProb, map<pair<int, int>, double>& memo) {
+    if (g == h) return 0.0;
+    if (isTerminal(g) && isTerminal(h)) return 1.0;
+    if (isTerminal(g)) return valueOf(g) ? 1.0 - up[h] : up[h];
+    if (isTerminal(h)) return valueOf(h) ? 1.0 - up[g] : up[g];
+
+    pair<int, int> key = g->id < h->id ? make_pair(g->id, h->id) : make_pair(h->id, g->id);
+    auto it = memo.find(key);
+    if (it != memo.end()) return it->second;
+
+    int lg = up.levels[g->foldIndex];
+    int lh = up.levels[h->foldIndex];
+    int l = min(lg, lh);
+    BDDNode* g0 = lg == l ? g->low : g;
+    BDDNode* g1 = lg == l ? g->high : g;
+    BDDNode* h0 = lh == l ? h->low : h;
+    BDDNode* h1 = lh == l ? h->high : h;
+    double q = levelProb[l];
+    double result = (1.0 - q) * differenceProbability(g0, h0, up, levelProb, memo) +
+                    q * differenceProbability(g1, h1, up, levelProb, memo);
+    memo[key] = result;
+    return result;
+}
+
+// One vector per root, indexed by level. Inputs missing from inputProb are 1 with
+// probability 0.5. The Birnbaum importance equals the influence for monotone f and is
+// bounded by it in absolute value otherwise (it is 0 for x in x XOR y).
+vector<vector<VariableSensitivity>> variableSensitivities(const vector<BDDNode*>& roots,
+                                                          const map<string, double>& inputProb,
+                                                          int numThreads = 0) {
+    size_t numLevels = manager->variableOrder.size();
+    vector<double> levelProb(numLevels, 0.5);
+    for (size_t l = 0; l < numLevels; ++l) {
+        auto it = inputProb.find(manager->variableOrder[l]);
+        if (it != inputProb.end()) levelProb[l] = it->second;
+    }
+
+    auto leaf = [](bool value) { return value ? 1.0 : 0.0; };
+    auto node = [&](BDDNode*, int level, double low, double high) {
+        double q = levelProb[level];
+        return (1.0 - q) * low + q * high;
+    };
+    BDDFold<double> up = foldBDD<double>(roots, leaf, node, FoldPolicy::LevelParallel, numThreads);
+    const vector<int>& level = up.levels;
+
+    vector<vector<VariableSensitivity>> result;
+    map<pair<int, int>, double> differenceMemo;
+    vector<double> reach(up.nodes.size());
+    for (BDDNode* root : roots) {
+        vector<VariableSensitivity> stats(numLevels);
+        for (size_t l = 0; l < numLevels; ++l) stats[l].variable = manager->variableOrder[l];
+        vector<double> joint(numLevels, 0.0);        // P(f = 1 and x = 1) through nodes on the level
+        vector<double> jumped(numLevels + 1, 0.0);   // difference array of P(f = 1) on skipping edges
+        auto jump = [&](int from, int to, double mass) {
+            if (from + 1 >= to) return;
+            jumped[from + 1] += mass;
+            jumped[to] -= mass;
+        };
+
+        fill(reach.begin(), reach.end(), 0.0);
+        uint32_t r = root ? root->foldIndex : 0;
+        reach[r] = 1.0;
+        jump(-1, level[r], up.values[r]);
+
+        // Parents come after their children in the fold's order.
+        for (size_t i = up.nodes.size(); i-- > 2;) {
+            if (reach[i] == 0) continue;
+            BDDNode* n = up.nodes[i];
+            uint32_t lo = n->low->foldIndex;
+            uint32_t hi = n->high->foldIndex;
+            int l = level[i];
+            double toLow = reach[i] * (1.0 - levelProb[l]);
+            double toHigh = reach[i] * levelProb[l];
+            reach[lo] += toLow;
+            reach[hi] += toHigh;
+
+            joint[l] += toHigh * up.values[hi];
+            stats[l].birnbaum += reach[i] * (up.values[hi] - up.values[lo]);
+            stats[l].influence += reach[i] * differenceProbability(n->low, n->high, up, levelProb, differenceMemo);
+            jump(l, level[lo], toLow * up.values[lo]);
+            jump(l, level[hi], toHigh * up.values[hi]);
+        }
+
+        // f does not depend on a jumped variable, so there x = 1 with its own probability.
+        double pf = up.values[r];
+        double crossing = 0;
+        for (size_t l = 0; l < numLevels; ++l) {
+            crossing += jumped[l];
+            if (pf > 0) stats[l].marginal = (joint[l] + levelProb[l] * crossing) / pf;
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+// -------------------------------- Shannon-Split Construction --------------------------------------//
+// f = ITE(x0, f|x0=1, f|x0=0) applied over the top k variables of the order: each of the
+// 2^k cofactor designs is built by its own thread in a manager of its own, then imported
+// into the caller's manager and merged with makeNode over the split variables.
+// Unlike cone-level parallelism this also helps when every output depends on every gate.
+
+struct SplitCofactor {
+    BDDManager manager;      // the worker's tables; its nodes go away with it
+    vector<BDDNode*> roots;  // one per output, in declaration order
+};
+
+// Runs on a worker thread.
+static void buildCofactorDesign(const string& verilogCode, const vector<string>& order,
+                                const map<string, bool>& fixed, SplitCofactor& result) {
+    ManagerScope scope(result.manager);
+    setVariableOrder(order);
+    ROBDDBuilder builder;
+    builder.fixInputs(fixed);
+    builder.buildROBDD(verilogCode);
+    for (const auto& out : builder.getOutputBDDs()) result.roots.push_back(out.second);
+}
+
+// log2 of the hardware threads, so that every core gets one cofactor.
+int defaultSplitDepth(int numInputs) {
+    int depth = 0;
+    while ((1 << (depth + 1)) <= defaultThreadCount()) depth++;
+    return min(depth, numInputs);
+}
+
+// Builds every output with the top splitDepth variables split off (-1 picks the depth from
+// the core count; 0 is the plain build). Only outputs get BDDs, internal signals stay unset.
+BDDNode* ROBDDBuilder::buildSplitROBDD(const string& verilogCode, int splitDepth) {
+    if (!parser.parse(verilogCode)) return nullptr;
+    applyFixedInputs();
+    lazy = false;
+
+    vector<string> order = manager->variableOrder;
+    int numInputs = (int)parser.getInputs().size();
+    int depth = splitDepth < 0 ? defaultSplitDepth(numInputs) : min(splitDepth, numInputs);
+    if (depth == 0) {
+        processGates();
+        if (!parser.getOutputs().empty()) return parser.getSignalBDD(parser.getOutputs()[0]);
+        return BDD_ZERO;
+    }
+
+    PhaseScope phase(PHASE_BUILD);
+    size_t count = (size_t)1 << depth;
+    vector<SplitCofactor> cofactors(count);
+    vector<thread> threads;
+    for (size_t c = 0; c < count; ++c) {
+        // Bit depth-1-j of c is the value of the j-th split variable.
+        map<string, bool> fixed = fixedInputs;
+        for (int j = 0; j < depth; ++j) fixed[order[j]] = (c >> (depth - 1 - j)) & 1;
+        threads.emplace_back(buildCofactorDesign, cref(verilogCode), cref(order), fixed, ref(cofactors[c]));
+    }
+    for (thread& th : threads) th.join();
+
+    vector<string> outputs = parser.getOutputs();
+    vector<map<int, BDDNode*>> imported(count);
+    for (size_t o = 0; o < outputs.size(); ++o) {
+        vector<BDDNode*> level(count);
+        for (size_t c = 0; c < count; ++c) level[c] = importNode(cofactors[c].roots[o], imported[c]);
+        // Merge bottom-up: the deepest split variable pairs neighbouring cofactors first.
+        for (int j = depth - 1; j >= 0; --j) {
+            vector<BDDNode*> merged(level.size() / 2);
+            for (size_t m = 0; m < merged.size(); ++m) merged[m] = makeNode(order[j], level[2 * m], level[2 * m + 1]);
+            level.swap(merged);
+        }
+        parser.setSignalBDD(outputs[o], level[0]);
+    }
+
+    if (!outputs.empty()) return parser.getSignalBDD(outputs[0]);
+    return BDD_ZERO;
+}
+
+// -------------------------------- Parallel Block Sifting --------------------------------------//
+// Sifting a variable inside its block [begin, end) of the order never moves a variable of
+// another block, so the blocks of a round are sifted on separate threads, each rebuilding
+// the design in a manager of its own with the rest of the order held fixed. The
+// blocks' orders are then spliced together. Their gains were measured separately and need
+// not add up, so the splice is kept only when it beats the best single block. Boundaries
+// shift by half a block every other round so that variables can cross them.
+
+struct BlockSiftResult {
+    vector<string> order;
+    double cost = 0;
+};
+
+// Runs on a worker thread.
+static void siftBlock(const string& verilogCode, const vector<string>& order, int begin, int end,
+                      SiftObjective objective, const map<string, double>& inputProb, BlockSiftResult& result) {
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    setVariableOrder(order);
+    PhaseScope phase(PHASE_SIFT);
+    double cost = siftCost(verilogCode, objective, inputProb);
+    result.cost = siftRange(verilogCode, begin, end, cost, objective, inputProb);
+    result.order = manager->variableOrder;
+}
+
+// Parallel variant of siftVariables: `rounds` rounds over numThreads blocks (0 = one per
+// hardware thread). Returns the final cost and leaves the tables built with the new order.
+double blockSiftVariables(const string& verilogCode, int numThreads = 0, int rounds = 2,
+                          SiftObjective objective = SiftObjective::NodeCount,
+                          const map<string, double>& inputProb = map<string, double>()) {
+    if (manager->variableOrder.empty()) return 0;
+    PhaseScope phase(PHASE_SIFT);
+
+    int numVars = (int)manager->variableOrder.size();
+    if (numThreads <= 0) numThreads = defaultThreadCount();
+    int blockSize = max(2, (numVars + numThreads - 1) / numThreads);
+
+    double cost = siftCost(verilogCode, objective, inputProb);
+    for (int round = 0; round < rounds; ++round) {
+        vector<pair<int, int>> blocks;
+        int begin = 0;
+        if (round % 2 == 1 && blockSize / 2 < numVars) {
+            blocks.push_back(make_pair(0, blockSize / 2));
+            begin = blockSize / 2;
+        }
+        for (; begin < numVars; begin += blockSize) blocks.push_back(make_pair(begin, min(numVars, begin + blockSize)));
+
+        vector<string> order = manager->variableOrder;
+        vector<BlockSiftResult> results(blocks.size());
+        vector<thread> threads;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (blocks[b].second - blocks[b].first < 2) continue;
+            threads.emplace_back(siftBlock, cref(verilogCode), cref(order), blocks[b].first, blocks[b].second, objective,
+                                 cref(inputProb), ref(results[b]));
+        }
+        for (thread& th : threads) th.join();
+
+        vector<string> spliced = order;
+        const BlockSiftResult* bestBlock = nullptr;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (results[b].order.empty()) continue;
+            copy(results[b].order.begin() + blocks[b].first, results[b].order.begin() + blocks[b].second,
+                 spliced.begin() + blocks[b].first);
+            if (!bestBlock || results[b].cost < bestBlock->cost) bestBlock = &results[b];
+        }
+
+        manager->variableOrder = spliced;
+        double splicedCost = siftCost(verilogCode, objective, inputProb);
+        if (bestBlock && bestBlock->cost < splicedCost) {
+            manager->variableOrder = bestBlock->order;
+            splicedCost = bestBlock->cost;
+        }
+        if (splicedCost >= cost) {
+            manager->variableOrder = order;
+            break;
+        }
+        cost = splicedCost;
+    }
+    rebuildROBDD(verilogCode);
+    return cost;
+}
+
+// -------------------------------- Process Worker Pool --------------------------------------//
+// Runs builds in forked worker processes, so a build that explodes or trips the per-worker
+// address-space limit (setrlimit RLIMIT_AS) only loses its own job. Output BDDs come back
+// as a Shared BDD Image over a pipe. Dead workers are reaped and replaced on the next job,
+// and workers can be recycled after a number of jobs so allocator fragmentation does not
+// build up in a long-running batch.
+
+struct BuildJob {
+    string name;
+    string verilogCode;
+};
+
+struct BuildJobResult {
+    string name;
+    bool ok = false;
+    string error;        // why the job failed when !ok
+    vector<char> image;  // the outputs as a Shared BDD Image when ok
+};
+
+enum PoolFrame : uint8_t { FRAME_BUILD = 1, FRAME_IMAGE = 2, FRAME_FAILED = 3 };
+
+static bool readAllBytes(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t got = read(fd, data, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+// Frame: tag byte, 64-bit payload size, payload.
+static bool writeFrame(int fd, PoolFrame tag, const char* data, size_t size) {
+    char header[9];
+    header[0] = (char)tag;
+    uint64_t length = size;
+    memcpy(header + 1, &length, sizeof(length));
+    return writeAllBytes(fd, header, sizeof(header)) && writeAllBytes(fd, data, size);
+}
+
+static bool readFrame(int fd, PoolFrame& tag, vector<char>& payload) {
+    char header[9];
+    if (!readAllBytes(fd, header, sizeof(header))) return false;
+    tag = (PoolFrame)header[0];
+    uint64_t length;
+    memcpy(&length, header + 1, sizeof(length));
+    payload.resize(length);
+    return readAllBytes(fd, payload.data(), length);
+}
+
+// Body of a worker process: build each design it is sent with a fresh manager.
+static void poolWorkerLoop(int requestFd, int replyFd, size_t memoryLimit) {
+    if (memoryLimit > 0) {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = memoryLimit;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    PoolFrame tag;
+    vector<char> request;
+    while (readFrame(requestFd, tag, request) && tag == FRAME_BUILD) {
+        vector<char> image;
+        string error;
+        try {
+            resetBDDTables();
+            setVariableOrder(vector<string>());
+            ROBDDBuilder builder;
+            builder.buildROBDD(string(request.begin(), request.end()));
+            vector<BDDNode*> roots;
+            vector<string> names;
+            for (const auto& out : builder.getOutputBDDs()) {
+                names.push_back(out.first);
+                roots.push_back(out.second);
+            }
+            image = serializeBDDImage(roots, names);
+        } catch (const bad_alloc&) {
+            error = "out of memory";
+        }
+
+        bool sent = error.empty() ? writeFrame(replyFd, FRAME_IMAGE, image.data(), image.size())
+                                  : writeFrame(replyFd, FRAME_FAILED, error.data(), error.size());
+        // After bad_alloc the heap is not worth reusing; the pool starts a fresh worker.
+        if (!sent || !error.empty()) break;
+    }
+    _exit(0);
+}
+
+class ProcessWorkerPool {
+private:
+    struct Worker {
+        pid_t pid = -1;
+        int requestFd = -1;
+        int replyFd = -1;
+        int jobsDone = 0;
+        int job = -1;  // index of the job in flight, -1 when idle
+    };
+
+    vector<Worker> workers;
+    size_t memoryLimit;
+    int maxJobsPerWorker;
+    int restarts = 0;
+
+    bool startWorker(Worker& w) {
+        int request[2], reply[2];
+        if (pipe(request) != 0) return false;
+        if (pipe(reply) != 0) {
+            close(request[0]);
+            close(request[1]);
+            return false;
+        }
+
+        cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            for (int fd : {request[0], request[1], reply[0], reply[1]}) close(fd);
+            return false;
+        }
+        if (pid == 0) {
+            // Other workers' pipes must not stay open here, or their EOF would never show.
+            for (const Worker& other : workers) {
+                if (other.requestFd >= 0) close(other.requestFd);
+                if (other.replyFd >= 0) close(other.replyFd);
+            }
+            close(request[1]);
+            close(reply[0]);
+            poolWorkerLoop(request[0], reply[1], memoryLimit);
+        }
+
+        close(request[0]);
+        close(reply[1]);
+        w.pid = pid;
+        w.requestFd = request[1];
+        w.replyFd = reply[0];
+        w.jobsDone = 0;
+        return true;
+    }
+
+    // Closing the request pipe makes an idle worker exit. Returns how the process ended.
+    string stopWorker(Worker& w) {
+        if (w.pid < 0) return "";
+        close(w.requestFd);
+        close(w.replyFd);
+        w.requestFd = w.replyFd = -1;
+
+        int status = 0;
+        while (waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        w.pid = -1;
+        if (WIFSIGNALED(status)) return string("worker killed by signal ") + to_string(WTERMSIG(status));
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0) return "worker exited with status " + to_string(WEXITSTATUS(status));
+        return "worker exited";
+    }
+
+public:
+    // memoryLimitBytes caps each worker's address space (0: no limit); maxJobs recycles a
+    // worker after that many jobs (0: never).
+    explicit ProcessWorkerPool(int numWorkers, size_t memoryLimitBytes = 0, int maxJobs = 0)
+        : workers((size_t)max(1, numWorkers)), memoryLimit(memoryLimitBytes), maxJobsPerWorker(maxJobs) {
+        // A worker dying mid-request must surface as a failed write, not kill the caller.
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    ~ProcessWorkerPool() {
+        for (Worker& w : workers) stopWorker(w);
+    }
+
+    ProcessWorkerPool(const ProcessWorkerPool&) = delete;
+    ProcessWorkerPool& operator=(const ProcessWorkerPool&) = delete;
+
+    int getRestarts() const { return restarts; }
+
+    // Results come back in job order. A job whose worker dies is reported as failed rather
+    // than retried, since it would most likely take the next worker down too.
+    vector<BuildJobResult> run(const vector<BuildJob>& jobs) {
+        vector<BuildJobResult> results(jobs.size());
+        for (size_t j = 0; j < jobs.size(); ++j) results[j].name = jobs[j].name;
+
+        vector<int> sendAttempts(jobs.size(), 0);
+        size_t next = 0;
+        size_t finished = 0;
+        while (finished < jobs.size()) {
+            for (Worker& w : workers) {
+                if (w.job >= 0 || next >= jobs.size()) continue;
+                if (w.pid < 0 && !startWorker(w)) {
+                    results[next].error = "cannot start worker";
+                    ++next;
+                    ++finished;
+                    continue;
+                }
+                const string& code = jobs[next].verilogCode;
+                if (!writeFrame(w.requestFd, FRAME_BUILD, code.data(), code.size())) {
+                    // Died while idle: the job never ran, so it gets one more try on a new worker.
+                    string reason = stopWorker(w);
+                    ++restarts;
+                    if (++sendAttempts[next] >= 2) {
+                        results[next].error = reason;
+                        ++next;
+                        ++finished;
+                    }
+                    continue;
+                }
+                w.job = (int)next++;
+            }
+
+            vector<pollfd> fds;
+            vector<Worker*> busy;
+            for (Worker& w : workers) {
+                if (w.job < 0) continue;
+                fds.push_back(pollfd{w.replyFd, POLLIN, 0});
+                busy.push_back(&w);
+            }
+            if (fds.empty()) continue;
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents == 0) continue;
+                Worker& w = *busy[i];
+                BuildJobResult& result = results[w.job];
+                w.job = -1;
+                ++finished;
+
+                PoolFrame tag;
+                vector<char> payload;
+                if (!readFrame(w.replyFd, tag, payload)) {
+                    result.error = stopWorker(w);
+                    ++restarts;
+                    continue;
+                }
+                if (tag == FRAME_IMAGE) {
+                    result.ok = true;
+                    result.image.swap(payload);
+                } else {
+                    result.error.assign(payload.begin(), payload.end());
+                }
+
+                if (tag != FRAME_IMAGE) {
+                    stopWorker(w);
+                    ++restarts;
+                } else if (maxJobsPerWorker > 0 && ++w.jobsDone >= maxJobsPerWorker) {
+                    stopWorker(w);
+                }
+            }
+        }
+        return results;
+    }
+};
+
+// -------------------------------- BDD Profile --------------------------------------//
+// Node count per level (the BDD "profile") plus how the outputs share nodes. Terminals
+// are not counted.
+
+struct BDDProfile {
+    vector<string> levelVars;
+    vector<int> levelWidth;
+    int totalNodes = 0;
+    vector<string> outputNames;
+    vector<int> outputNodes;       // nodes in the output's cone
+    vector<int> outputShared;      // ... that at least one other output also reaches
+    vector<int> outputExclusive;   // ... that only this output reaches
+    vector<vector<int>> pairShared;
+};
+
+BDDProfile computeBDDProfile(const vector<pair<string, BDDNode*>>& outputs) {
+    BDDProfile profile;
+    vector<BDDNode*> roots;
+    for (const auto& out : outputs) {
+        profile.outputNames.push_back(out.first);
+        roots.push_back(out.second);
+    }
+
+    LevelizedBDD bdd = levelizeBDD(roots);
+    profile.levelVars = manager->variableOrder;
+    for (const vector<uint32_t>& level : bdd.levels) {
+        profile.levelWidth.push_back((int)level.size());
+        profile.totalNodes += (int)level.size();
+    }
+
+    size_t numOutputs = roots.size();
+    vector<vector<uint32_t>> owners(bdd.nodes.size());
+    vector<int> stamp(bdd.nodes.size(), -1);
+    vector<uint32_t> stack;
+    for (size_t o = 0; o < numOutputs; ++o) {
+        stack.push_back(bdd.roots[o]);
+        while (!stack.empty()) {
+            uint32_t i = stack.back();
+            stack.pop_back();
+            if (i < 2 || stamp[i] == (int)o) continue;
+            stamp[i] = (int)o;
+            owners[i].push_back((uint32_t)o);
+            stack.push_back(bdd.low[i]);
+            stack.push_back(bdd.high[i]);
+        }
+    }
+
+    profile.outputNodes.assign(numOutputs, 0);
+    profile.outputShared.assign(numOutputs, 0);
+    profile.outputExclusive.assign(numOutputs, 0);
+    profile.pairShared.assign(numOutputs, vector<int>(numOutputs, 0));
+    for (const vector<uint32_t>& own : owners) {
+        for (size_t a = 0; a < own.size(); ++a) {
+            profile.outputNodes[own[a]]++;
+            if (own.size() == 1) profile.outputExclusive[own[a]]++;
+            else profile.outputShared[own[a]]++;
+            for (size_t b = a; b < own.size(); ++b) {
+                profile.pairShared[own[a]][own[b]]++;
+                if (a != b) profile.pairShared[own[b]][own[a]]++;
+            }
+        }
+    }
+    return profile;
+}
+
+static string jsonString(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+string profileToJSON(const BDDProfile& profile) {
+    stringstream ss;
+    ss << "{\n  \"totalNodes\": " << profile.totalNodes << ",\n  \"levels\": [";
+    for (size_t l = 0; l < profile.levelVars.size(); ++l) {
+        ss << (l ? "," : "") << "\n    {\"level\": " << l << ", \"variable\": " << jsonString(profile.levelVars[l])
+           << ", \"nodes\": " << profile.levelWidth[l] << "}";
+    }
+    ss << "\n  ],\n  \"outputs\": [";
+    for (size_t o = 0; o < profile.outputNames.size(); ++o) {
+        ss << (o ? "," : "") << "\n    {\"name\": " << jsonString(profile.outputNames[o])
+           << ", \"nodes\": " << profile.outputNodes[o] << ", \"shared\": " << profile.outputShared[o]
+           << ", \"exclusive\": " << profile.outputExclusive[o] << "}";
+    }
+    ss << "\n  ],\n  \"pairShared\": [";
+    for (size_t a = 0; a < profile.pairShared.size(); ++a) {
+        ss << (a ? "," : "") << "\n    [";
+        for (size_t b = 0; b < profile.pairShared[a].size(); ++b) ss << (b ? ", " : "") << profile.pairShared[a][b];
+        ss << "]";
+    }
+    ss << "\n  ]\n}\n";
+    return ss.str();
+}
+
+void printBDDProfile(const BDDProfile& profile) {
+    cout << "BDD profile (" << profile.totalNodes << " nodes):" << endl;
+    for (size_t l = 0; l < profile.levelVars.size(); ++l)
+        cout << "  " << l << " " << profile.levelVars[l] << ": " << profile.levelWidth[l] << endl;
+    cout << "Output sharing (nodes / shared / exclusive):" << endl;
+    for (size_t o = 0; o < profile.outputNames.size(); ++o) {
+        cout << "  " << profile.outputNames[o] << ": " << profile.outputNodes[o] << " / "
+             << profile.outputShared[o] << " / " << profile.outputExclusive[o] << endl;
+    }
+}
+
+// -------------------------------- Schedule Comparison --------------------------------------//
+// Builds the design once per scheduling policy and reports the peak number of live nodes
+// (reachable from signals that are still needed) next to the nodes actually allocated.
+// Every build runs in a scratch manager of its own, so the caller's BDDs are untouched.
+
+struct ScheduleReport {
+    SchedulePolicy policy;
+    int peakLiveNodes;
+    int allocatedNodes;
+};
+
+vector<ScheduleReport> compareSchedulePolicies(const string& verilogCode) {
+    vector<ScheduleReport> reports;
+    for (SchedulePolicy p : {SchedulePolicy::Levelized, SchedulePolicy::DepthFirstCone, SchedulePolicy::ConeMaxFree}) {
+        BDDManager scratch;
+        ManagerScope scope(scratch);
+        ROBDDBuilder builder;
+        builder.setSchedulePolicy(p);
+        builder.setTrackLiveNodes(true);
+        builder.buildROBDD(verilogCode);
+        reports.push_back(ScheduleReport{p, builder.getPeakLiveNodes(), computeBDDSize()});
+    }
+    return reports;
+}
+
+// -------------------------------- C++ Code Generation --------------------------------------//
+// Emits a self-contained C++ evaluator for a set of output BDDs, meant to be compiled into
+// a simulator at build time. Inputs are indexed by variable level (in[0] is the top of
+// variableOrder). Each output gets a goto chain in which a node's low child falls through
+// whenever possible and edges to terminals return directly; nodes reached from several
+// places become labels, so shared subgraphs are emitted once per output. The _x64 variant
+// evaluates 64 input vectors per call as straight-line bitwise code shared by all outputs.
+
+static string codegenEdge(BDDNode* n) {
+    if (n == BDD_ONE) return "return true;";
+    if (n == BDD_ZERO) return "return false;";
+    return "goto n" + to_string(n->id) + ";";
+}
+
+static void emitGotoChain(ostringstream& code, BDDNode* root) {
+    if (isTerminal(root)) {
+        code << "    " << codegenEdge(root) << "\n";
+        return;
+    }
+
+    // Depth-first, low child first, so that most low edges can fall through.
+    vector<BDDNode*> sequence;
+    set<int> seen;
+    vector<BDDNode*> stack = {root};
+    while (!stack.empty()) {
+        BDDNode* n = stack.back();
+        stack.pop_back();
+        if (isTerminal(n) || !seen.insert(n->id).second) continue;
+        sequence.push_back(n);
+        stack.push_back(n->high);
+        stack.push_back(n->low);
+    }
+
+    set<int> labelled;
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        BDDNode* n = sequence[i];
+        BDDNode* next = i + 1 < sequence.size() ? sequence[i + 1] : nullptr;
+        if (!isTerminal(n->high)) labelled.insert(n->high->id);
+        if (n->low != next && !isTerminal(n->low)) labelled.insert(n->low->id);
+    }
+
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        BDDNode* n = sequence[i];
+        BDDNode* next = i + 1 < sequence.size() ? sequence[i + 1] : nullptr;
+        string var = "in[" + to_string(getVariableIndex(n->variable)) + "]";
+        code << (labelled.count(n->id) ? "n" + to_string(n->id) + ":\n" : "");
+        if (n->high == BDD_ONE && n->low == BDD_ZERO) {
+            code << "    return " << var << ";\n";
+        } else if (n->high == BDD_ZERO && n->low == BDD_ONE) {
+            code << "    return !" << var << ";\n";
+        } else {
+            code << "    if (" << var << ") " << codegenEdge(n->high) << "\n";
+            if (n->low != next) code << "    " << codegenEdge(n->low) << "\n";
+        }
+    }
+}
+
+static string codegenLanes(BDDNode* n) {
+    if (n == BDD_ONE) return "~UINT64_C(0)";
+    if (n == BDD_ZERO) return "UINT64_C(0)";
+    return "n" + to_string(n->id);
+}
+
+string generateEvaluatorCpp(const vector<pair<string, BDDNode*>>& outputs, const string& functionName) {
+    ostringstream code;
+    code << "// Generated by robdd. in[i] is the value of " << functionName << "_inputs[i].\n";
+    code << "#include <cstdint>\n\n";
+
+    code << "static const char* const " << functionName << "_inputs[] = {";
+    for (size_t i = 0; i < manager->variableOrder.size(); ++i) code << (i ? ", " : "") << jsonString(manager->variableOrder[i]);
+    code << (manager->variableOrder.empty() ? "nullptr" : "") << "};\n";
+    code << "static const char* const " << functionName << "_outputs[] = {";
+    for (size_t i = 0; i < outputs.size(); ++i) code << (i ? ", " : "") << jsonString(outputs[i].first);
+    code << (outputs.empty() ? "nullptr" : "") << "};\n";
+
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        code << "\n// " << outputs[i].first << "\n";
+        code << "inline bool " << functionName << "_" << i << "(const bool* in) {\n";
+        emitGotoChain(code, outputs[i].second);
+        code << "}\n";
+    }
+
+    code << "\ninline void " << functionName << "(const bool* in, bool* out) {\n";
+    code << "    (void)in;\n    (void)out;\n";
+    for (size_t i = 0; i < outputs.size(); ++i) code << "    out[" << i << "] = " << functionName << "_" << i << "(in);\n";
+    code << "}\n";
+
+    // Bit-parallel variant: lane j of in[i] / out[k] belongs to input vector j.
+    vector<BDDNode*> roots;
+    for (const auto& out : outputs) roots.push_back(out.second);
+    code << "\ninline void " << functionName << "_x64(const uint64_t* in, uint64_t* out) {\n";
+    code << "    (void)in;\n    (void)out;\n";
+    for (BDDNode* n : collectNodes(roots)) {
+        if (isTerminal(n)) continue;
+        string var = "in[" + to_string(getVariableIndex(n->variable)) + "]";
+        code << "    const uint64_t " << codegenLanes(n) << " = (" << var << " & " << codegenLanes(n->high) << ") | (~"
+             << var << " & " << codegenLanes(n->low) << ");\n";
+    }
+    for (size_t i = 0; i < outputs.size(); ++i) code << "    out[" << i << "] = " << codegenLanes(outputs[i].second) << ";\n";
+    code << "}\n";
+    return code.str();
+}
+
+bool writeEvaluatorCppFile(const string& path, const vector<pair<string, BDDNode*>>& outputs, const string& functionName) {
+    ofstream out(path);
+    if (!out) return false;
+    out << generateEvaluatorCpp(outputs, functionName);
+    return (bool)out;
+}
+
+// -------------------------------- Benchmark Suite --------------------------------------//
+// Times build and sifting on a fixed set of generated circuits (plus any Verilog files
+// given on the command line) and compares the results against a stored baseline. A
+// circuit regresses when its final node count grows, or when build or sift time is
+// slower by more than the threshold and Welch's t-test calls the slowdown significant.
+
+struct BenchCircuit {
+    string name;
+    string verilog;
+};
+
+struct BenchResult {
+    string name;
+    int nodes = 0;
+    vector<double> buildSeconds;
+    vector<double> siftSeconds;
+};
+
+static string joinSignals(const string& prefix, int count) {
+    string out;
+    for (int i = 0; i < count; ++i) out += (i ? ", " : "") + prefix + to_string(i);
+    return out;
+}
+
+string generateAdder(int bits) {
+    stringstream v;
+    v << "input " << joinSignals("a", bits) << ", " << joinSignals("b", bits) << ";\n";
+    v << "output " << joinSignals("s", bits) << ", cout;\n";
+    v << "wire " << joinSignals("c", bits + 1) << ", " << joinSignals("p", bits) << ", " << joinSignals("g", bits)
+      << ", " << joinSignals("t", bits) << ";\n";
+    v << "xor(c0, a0, a0);\n";
+    for (int i = 0; i < bits; ++i) {
+        string n = to_string(i);
+        v << "xor(p" << n << ", a" << n << ", b" << n << ");\n";
+        v << "and(g" << n << ", a" << n << ", b" << n << ");\n";
+        v << "xor(s" << n << ", p" << n << ", c" << n << ");\n";
+        v << "and(t" << n << ", p" << n << ", c" << n << ");\n";
+        v << "or(c" << i + 1 << ", g" << n << ", t" << n << ");\n";
+    }
+    v << "or(cout, c" << bits << ", c" << bits << ");\nendmodule\n";
+    return v.str();
+}
+
+string generateParity(int bits) {
+    stringstream v;
+    v << "input " << joinSignals("x", bits) << ";\noutput y;\nwire " << joinSignals("q", bits) << ";\n";
+    v << "or(q0, x0, x0);\n";
+    for (int i = 1; i < bits; ++i) v << "xor(q" << i << ", q" << i - 1 << ", x" << i << ");\n";
+    v << "or(y, q" << bits - 1 << ", q" << bits - 1 << ");\nendmodule\n";
+    return v.str();
+}
+
+// a > b, scanning from the least significant bit.
+string generateComparator(int bits) {
+    stringstream v;
+    v << "input " << joinSignals("a", bits) << ", " << joinSignals("b", bits) << ";\noutput gt;\n";
+    v << "wire " << joinSignals("nb", bits) << ", " << joinSignals("e", bits) << ", " << joinSignals("w", bits)
+      << ", " << joinSignals("k", bits) << ", " << joinSignals("r", bits) << ";\n";
+    for (int i = 0; i < bits; ++i) {
+        string n = to_string(i);
+        v << "not(nb" << n << ", b" << n << ");\n";
+        v << "and(w" << n << ", a" << n << ", nb" << n << ");\n";
+        v << "xor(e" << n << ", a" << n << ", b" << n << ");\n";
+        if (i == 0) {
+            v << "or(r0, w0, w0);\n";
+            continue;
+        }
+        v << "nand(k" << n << ", e" << n << ", e" << n << ");\n";  // k = a == b
+        v << "and(r" << n << "_keep, k" << n << ", r" << i - 1 << ");\n";
+        v << "or(r" << n << ", w" << n << ", r" << n << "_keep);\n";
+    }
+    v << "or(gt, r" << bits - 1 << ", r" << bits - 1 << ");\nendmodule\n";
+    return v.str();
+}
+
+vector<BenchCircuit> builtinBenchCircuits() {
+    return {
+        {"adder6", generateAdder(6)},
+        {"parity12", generateParity(12)},
+        {"comparator6", generateComparator(6)},
+    };
+}
+
+// One run: build in declaration order, sift, then rebuild in the sifted order. Each run
+// gets a fresh scratch manager, so runs start alike and the caller's BDDs are untouched.
+static void runBenchOnce(const string& verilog, BenchResult& result) {
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+
+    auto t0 = chrono::steady_clock::now();
+    {
+        ROBDDBuilder builder;
+        builder.buildROBDD(verilog);
+    }
+    auto t1 = chrono::steady_clock::now();
+    siftVariables(verilog);
+    auto t2 = chrono::steady_clock::now();
+
+    resetBDDTables();
+    ROBDDBuilder builder;
+    builder.buildROBDD(verilog);
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+
+    result.nodes = (int)collectNodes(roots).size() - 2;
+    result.buildSeconds.push_back(chrono::duration<double>(t1 - t0).count());
+    result.siftSeconds.push_back(chrono::duration<double>(t2 - t1).count());
+}
+
+vector<BenchResult> runBenchmarks(const vector<BenchCircuit>& circuits, int runs) {
+    vector<BenchResult> results;
+    for (const BenchCircuit& circuit : circuits) {
+        BenchResult result;
+        result.name = circuit.name;
+        for (int r = 0; r < runs; ++r) runBenchOnce(circuit.verilog, result);
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool writeBenchResults(const string& path, const vector<BenchResult>& results) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "# robdd benchmark results v1\n";
+    out.precision(9);
+    for (const BenchResult& r : results) {
+        out << "circuit " << r.name << " nodes " << r.nodes << " build";
+        for (double s : r.buildSeconds) out << " " << s;
+        out << " sift";
+        for (double s : r.siftSeconds) out << " " << s;
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+bool readBenchResults(const string& path, vector<BenchResult>& results) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream ss(line);
+        string word;
+        BenchResult r;
+        vector<double>* samples = nullptr;
+        while (ss >> word) {
+            if (word == "circuit") ss >> r.name;
+            else if (word == "nodes") ss >> r.nodes;
+            else if (word == "build") samples = &r.buildSeconds;
+            else if (word == "sift") samples = &r.siftSeconds;
+            else if (samples) samples->push_back(stod(word));
+        }
+        if (!r.name.empty()) results.push_back(r);
+    }
+    return true;
+}
+
+static void sampleMeanVar(const vector<double>& xs, double& mean, double& var) {
+    mean = 0;
+    for (double x : xs) mean += x;
+    mean /= (double)max<size_t>(xs.size(), 1);
+    var = 0;
+    for (double x : xs) var += (x - mean) * (x - mean);
+    var = xs.size() > 1 ? var / (double)(xs.size() - 1) : 0;
+}
+
+// One-sided 95% critical value of Student's t.
+static double tCritical95(double df) {
+    static const double table[][2] = {{1, 6.314}, {2, 2.920}, {3, 2.353}, {4, 2.132}, {5, 2.015}, {6, 1.943},
+                                      {7, 1.895}, {8, 1.860}, {9, 1.833}, {10, 1.812}, {12, 1.782}, {15, 1.753},
+                                      {20, 1.725}, {30, 1.697}};
+    for (const auto& row : table) {
+        if (df <= row[0]) return row[1];
+    }
+    return 1.645;
+}
+
+// True when `current` is slower than `baseline` by more than minRelative and the
+// difference is significant under Welch's t-test. Without two samples per side, or with
+// no variance at all, the test cannot tell and nothing is flagged.
+bool significantSlowdown(const vector<double>& baseline, const vector<double>& current, double minRelative) {
+    if (baseline.size() < 2 || current.size() < 2) return false;
+    double m0, v0, m1, v1;
+    sampleMeanVar(baseline, m0, v0);
+    sampleMeanVar(current, m1, v1);
+    if (m1 <= m0 * (1.0 + minRelative)) return false;
+
+    double se0 = v0 / (double)baseline.size();
+    double se1 = v1 / (double)current.size();
+    if (se0 + se1 == 0) return false;
+
+    double t = (m1 - m0) / sqrt(se0 + se1);
+    double dfDenominator = se0 * se0 / (double)(baseline.size() - 1) + se1 * se1 / (double)(current.size() - 1);
+    double df = (se0 + se1) * (se0 + se1) / dfDenominator;
+    return t > tCritical95(df);
+}
+
+// Prints one line per circuit and metric; returns the number of regressions.
+int compareBenchResults(const vector<BenchResult>& baseline, const vector<BenchResult>& current, double minRelative) {
+    int regressions = 0;
+    for (const BenchResult& cur : current) {
+        const BenchResult* base = nullptr;
+        for (const BenchResult& b : baseline) {
+            if (b.name == cur.name) base = &b;
+        }
+        if (!base) {
+            cout << cur.name << ": no baseline" << endl;
+            continue;
+        }
+
+        bool nodesUp = cur.nodes > base->nodes;
+        cout << cur.name << " nodes: " << base->nodes << " -> " << cur.nodes << (nodesUp ? "  REGRESSION" : "") << endl;
+        regressions += nodesUp;
+
+        const pair<const char*, pair<const vector<double>*, const vector<double>*>> metrics[] = {
+            {"build", {&base->buildSeconds, &cur.buildSeconds}},
+            {"sift", {&base->siftSeconds, &cur.siftSeconds}},
+        };
+        for (const auto& metric : metrics) {
+            double m0, v0, m1, v1;
+            sampleMeanVar(*metric.second.first, m0, v0);
+            sampleMeanVar(*metric.second.second, m1, v1);
+            bool slower = significantSlowdown(*metric.second.first, *metric.second.second, minRelative);
+            cout << cur.name << " " << metric.first << ": " << m0 << " s -> " << m1 << " s ("
+                 << (m0 > 0 ? 100.0 * (m1 - m0) / m0 : 0.0) << "%)" << (slower ? "  REGRESSION" : "") << endl;
+            regressions += slower;
+        }
+    }
+    return regressions;
+}
+
+// -------------------------------- Autotuning --------------------------------------//
+// Short calibration builds of one design choose the computed-cache size, the thread count
+// used by split construction and the folds, and the node count above which a design gets
+// sifted without being asked. The choice is stored per design family, by default the
+// module name without its trailing digits (c432 and c880 are both "c"), and later runs of
+// that family load it.
+
+struct TuningProfile {
+    string family;
+    size_t applyCacheEntries = (size_t)1 << 16;
+    int threads = 0;             // 0 = one per hardware thread
+    int reorderThreshold = 0;    // sift when the unsifted build has more nodes; 0 = never
+    double gatesPerSecond = 0;   // build throughput measured with these settings
+};
+
+// The sifting calibration is skipped when it would probably take longer than this.
+const double TUNE_SIFT_BUDGET_SECONDS = 2.0;
+
+string designFamily(const string& verilogCode) {
+    string name;
+    size_t pos = verilogCode.find("module");
+    if (pos != string::npos) {
+        size_t open = verilogCode.find('(', pos);
+        stringstream header(verilogCode.substr(pos + 6, open == string::npos ? string::npos : open - pos - 6));
+        header >> name;
+    }
+    while (!name.empty() && (isdigit((unsigned char)name.back()) || name.back() == '_')) name.pop_back();
+    return name.empty() ? "default" : name;
+}
+
+void applyTuningProfile(const TuningProfile& profile) {
+    setApplyCacheEntries(profile.applyCacheEntries);
+    threadCountOverride = profile.threads;
+}
+
+// Fastest of `runs` builds in declaration order (one is enough once a build takes a
+// second); split construction follows the current thread count. Every run builds in a
+// fresh scratch manager.
+static double timeCalibrationBuild(const string& verilogCode, int runs, bool split) {
+    double best = 0;
+    for (int r = 0; r < runs; ++r) {
+        BDDManager scratch;
+        ManagerScope scope(scratch);
+        auto t0 = chrono::steady_clock::now();
+        {
+            ROBDDBuilder builder;
+            if (split) builder.buildSplitROBDD(verilogCode);
+            else builder.buildROBDD(verilogCode);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if (r == 0 || seconds < best) best = seconds;
+        if (seconds > 1.0) break;
+    }
+    return best;
+}
+
+// Calibrates in scratch managers, so the caller's BDDs and order are untouched. The chosen
+// cache size and thread count are left applied.
+TuningProfile autotuneDesign(const string& verilogCode, const string& family, int runs = 3) {
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    TuningProfile profile;
+    profile.family = family;
+
+    // Largest cache first. The smallest one within 5% of the fastest wins, and once a size
+    // is far behind, smaller ones will not catch up.
+    double cacheSeconds = -1;
+    double fastest = -1;
+    for (size_t entries : {(size_t)1 << 20, (size_t)1 << 18, (size_t)1 << 16, (size_t)1 << 14, (size_t)1 << 12,
+                           (size_t)0}) {
+        setApplyCacheEntries(entries);
+        double seconds = timeCalibrationBuild(verilogCode, runs, false);
+        if (fastest < 0 || seconds <= fastest * 1.05) {
+            profile.applyCacheEntries = entries;
+            cacheSeconds = seconds;
+        }
+        if (fastest < 0 || seconds < fastest) fastest = seconds;
+        if (seconds > 4 * fastest) break;
+    }
+    setApplyCacheEntries(profile.applyCacheEntries);
+
+    // Each doubling of the threads has to buy at least 5%.
+    int hardware = (int)max(1u, thread::hardware_concurrency());
+    double buildSeconds = cacheSeconds;
+    profile.threads = 1;
+    for (int threads = 2; threads <= hardware; threads *= 2) {
+        threadCountOverride = threads;
+        double seconds = timeCalibrationBuild(verilogCode, runs, true);
+        if (seconds < buildSeconds * 0.95) {
+            buildSeconds = seconds;
+            profile.threads = threads;
+        }
+    }
+    threadCountOverride = profile.threads;
+
+    VerilogParser parser;
+    parser.parse(verilogCode);
+    profile.gatesPerSecond = (double)parser.getGates().size() / max(buildSeconds, 1e-9);
+
+    // A pass of sifting costs about numVars^2 builds. When one round shrinks this design
+    // by a tenth, family members from half its size up are sifted automatically.
+    int numVars = (int)manager->variableOrder.size();
+    if (numVars > 1 && cacheSeconds * numVars * numVars <= TUNE_SIFT_BUDGET_SECONDS) {
+        rebuildROBDD(verilogCode);
+        int unsifted = computeBDDSize();
+        double sifted = blockSiftVariables(verilogCode, profile.threads, 1);
+        if (sifted <= 0.9 * unsifted) profile.reorderThreshold = max(1, unsifted / 2);
+    }
+    return profile;
+}
+
+// Whether the design, built in declaration order, is larger than the threshold. The trial
+// build runs in a scratch manager.
+bool exceedsReorderThreshold(const string& verilogCode, int threshold) {
+    if (threshold <= 0) return false;
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    rebuildROBDD(verilogCode);
+    return computeBDDSize() > threshold;
+}
+
+string defaultTuningProfilePath() {
+    const char* path = getenv("ROBDD_TUNING");
+    return path ? path : "robdd_tuning.txt";
+}
+
+bool writeTuningProfiles(const string& path, const map<string, TuningProfile>& profiles) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "# robdd tuning profiles v1\n";
+    for (const auto& entry : profiles) {
+        const TuningProfile& p = entry.second;
+        out << "family " << p.family << " cache " << p.applyCacheEntries << " threads " << p.threads << " reorder "
+            << p.reorderThreshold << " throughput " << p.gatesPerSecond << "\n";
+    }
+    return (bool)out;
+}
+
+bool readTuningProfiles(const string& path, map<string, TuningProfile>& profiles) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream ss(line);
+        string word;
+        TuningProfile p;
+        while (ss >> word) {
+            if (word == "family") ss >> p.family;
+            else if (word == "cache") ss >> p.applyCacheEntries;
+            else if (word == "threads") ss >> p.threads;
+            else if (word == "reorder") ss >> p.reorderThreshold;
+            else if (word == "throughput") ss >> p.gatesPerSecond;
+        }
+        if (!p.family.empty()) profiles[p.family] = p;
+    }
+    return true;
+}
+
+// -------------------------------- Multi-Valued Decision Diagrams --------------------------------------//
+// MDD nodes branch k ways on a variable with a finite domain {0, ..., k-1}. They use the
+// same scheme as makeNode: one unique sub-table per level keyed by the children's ids, and
+// a node whose children are all equal is skipped. MDD variables have their own order so
+// they never show up in BDD statistics; an MDDEncoding ties each one to the BDD variables
+// of its binary code.
+
+struct MDDNode {
+    int id;
+    string variable;
+    vector<MDDNode*> children;
+
+    MDDNode(string var, const vector<MDDNode*>& c) : variable(var), children(c) {
+        static int counter = 0;
+        id = counter++;
+        memCharge(MEM_NODES, (int64_t)(sizeof(MDDNode) + stringHeapBytes(variable) +
+                                       children.capacity() * sizeof(MDDNode*)));
+    }
+};
+
+MDDNode* MDD_ZERO = nullptr;
+MDDNode* MDD_ONE = nullptr;
+
+using MDDLevelTable = map<vector<int>, MDDNode*, less<vector<int>>,
+                          TrackingAllocator<pair<const vector<int>, MDDNode*>, MEM_UNIQUE_TABLE>>;
+
+vector<string> mddVariableOrder;
+map<string, int> mddLevel;
+map<string, int> mddDomain;
+vector<MDDLevelTable> mddUniqueTable;
+
+void resetMDDTables() {
+    mddUniqueTable.assign(mddVariableOrder.size(), MDDLevelTable());
+    MDD_ZERO = new MDDNode("0", vector<MDDNode*>());
+    MDD_ONE  = new MDDNode("1", vector<MDDNode*>());
+}
+
+inline bool isMDDTerminal(MDDNode* n) { return n == MDD_ZERO || n == MDD_ONE; }
+
+int getMDDLevel(const string& var) {
+    auto it = mddLevel.find(var);
+    if (it != mddLevel.end()) return it->second;
+    return (int)mddVariableOrder.size();
+}
+
+// Registers a variable with values 0..domainSize-1 at the given MDD level (default: last).
+// Deeper levels shift down in place, as with newVarAtLevel.
+int newMDDVar(const string& name, int domainSize, int level = -1) {
+    if (!MDD_ZERO) resetMDDTables();
+    auto it = mddLevel.find(name);
+    if (it != mddLevel.end()) return it->second;
+
+    int size = (int)mddVariableOrder.size();
+    level = (level < 0 || level > size) ? size : level;
+    mddVariableOrder.insert(mddVariableOrder.begin() + level, name);
+    mddUniqueTable.insert(mddUniqueTable.begin() + level, MDDLevelTable());
+    mddDomain[name] = max(domainSize, 1);
+    for (int l = level; l <= size; ++l) mddLevel[mddVariableOrder[l]] = l;
+    return level;
+}
+
+// var must be registered and children must cover its domain; the public entry points
+// check that before building anything.
+static MDDNode* mddMakeNode(const string& var, const vector<MDDNode*>& children) {
+    bool allSame = true;
+    for (MDDNode* child : children) allSame = allSame && child == children[0];
+    if (allSame) return children[0];
+
+    int level = getMDDLevel(var);
+    vector<int> key;
+    for (MDDNode* child : children) key.push_back(child->id);
+
+    MDDLevelTable& table = mddUniqueTable[level];
+    auto it = table.find(key);
+    if (it != table.end()) return it->second;
+
+    MDDNode* node = new MDDNode(var, children);
+    table[key] = node;
+    return node;
+}
+
+// 1 exactly when var takes one of the given values. Fails for a variable that was never
+// registered with newMDDVar.
+bool mddLiteral(const string& var, const set<int>& values, MDDNode*& result) {
+    if (!MDD_ZERO) resetMDDTables();
+    auto domain = mddDomain.find(var);
+    if (domain == mddDomain.end()) return false;
+    vector<MDDNode*> children;
+    for (int v = 0; v < domain->second; ++v) children.push_back(values.count(v) ? MDD_ONE : MDD_ZERO);
+    result = mddMakeNode(var, children);
+    return true;
+}
+
+static MDDNode* mddApplyRec(MDDNode* f, MDDNode* g, const OpFunc& op, map<pair<int, int>, MDDNode*>& memo) {
+    if (isMDDTerminal(f) && isMDDTerminal(g)) return op(f == MDD_ONE, g == MDD_ONE) ? MDD_ONE : MDD_ZERO;
+
+    pair<int, int> key = make_pair(f->id, g->id);
+    auto it = memo.find(key);
+    if (it != memo.end()) return it->second;
+
+    int fLevel = isMDDTerminal(f) ? (int)mddVariableOrder.size() : getMDDLevel(f->variable);
+    int gLevel = isMDDTerminal(g) ? (int)mddVariableOrder.size() : getMDDLevel(g->variable);
+    const string& var = fLevel <= gLevel ? f->variable : g->variable;
+
+    vector<MDDNode*> children;
+    for (int v = 0; v < mddDomain[var]; ++v) {
+        MDDNode* fc = fLevel <= gLevel ? f->children[v] : f;
+        MDDNode* gc = gLevel <= fLevel ? g->children[v] : g;
+        children.push_back(mddApplyRec(fc, gc, op, memo));
+    }
+    MDDNode* result = mddMakeNode(var, children);
+    memo[key] = result;
+    return result;
+}
+
+MDDNode* mddApply(MDDNode* f, MDDNode* g, OpFunc op) {
+    map<pair<int, int>, MDDNode*> memo;
+    return mddApplyRec(f, g, op, memo);
+}
+
+MDDNode* mddNot(MDDNode* f) {
+    return mddApply(f, MDD_ONE, XorOp);
+}
+
+// Combines the cofactors of var with op: OR gives exists, AND gives forall.
+static MDDNode* mddQuantifyRec(MDDNode* f, const string& var, int level, const OpFunc& op, map<int, MDDNode*>& memo) {
+    if (isMDDTerminal(f) || getMDDLevel(f->variable) > level) return f;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+
+    MDDNode* result;
+    if (f->variable == var) {
+        result = f->children[0];
+        for (size_t v = 1; v < f->children.size(); ++v) result = mddApply(result, f->children[v], op);
+    } else {
+        vector<MDDNode*> children;
+        for (MDDNode* child : f->children) children.push_back(mddQuantifyRec(child, var, level, op, memo));
+        result = mddMakeNode(f->variable, children);
+    }
+    memo[f->id] = result;
+    return result;
+}
+
+MDDNode* mddExists(MDDNode* f, const string& var) {
+    map<int, MDDNode*> memo;
+    return mddQuantifyRec(f, var, getMDDLevel(var), OrOp, memo);
+}
+
+MDDNode* mddForall(MDDNode* f, const string& var) {
+    map<int, MDDNode*> memo;
+    return mddQuantifyRec(f, var, getMDDLevel(var), AndOp, memo);
+}
+
+bool mddEvaluate(MDDNode* f, const map<string, int>& values) {
+    while (!isMDDTerminal(f)) f = f->children[values.at(f->variable)];
+    return f == MDD_ONE;
+}
+
+size_t mddSize(MDDNode* root) {
+    set<int> visited;
+    vector<MDDNode*> stack = {root};
+    while (!stack.empty()) {
+        MDDNode* n = stack.back();
+        stack.pop_back();
+        if (isMDDTerminal(n) || visited.count(n->id)) continue;
+        visited.insert(n->id);
+        for (MDDNode* child : n->children) stack.push_back(child);
+    }
+    return visited.size();
+}
+
+// MDD variable -> BDD variables of its binary code, least significant bit first.
+struct MDDEncoding {
+    map<string, vector<string>> bits;
+};
+
+// Creates "<var>_b<i>" BDD variables for every MDD variable, grouped per variable in MDD
+// order (most significant bit on top) starting at the given BDD level (default: bottom).
+MDDEncoding encodeMDDVariables(int level = -1) {
+    MDDEncoding encoding;
+    if (level < 0) level = (int)manager->variableOrder.size();
+    for (const string& var : mddVariableOrder) {
+        int width = 1;
+        while ((1 << width) < mddDomain[var]) ++width;
+
+        vector<string>& bits = encoding.bits[var];
+        for (int b = 0; b < width; ++b) bits.push_back(var + "_b" + to_string(b));
+        for (int b = width - 1; b >= 0; --b) newVarAtLevel(level++, bits[b]);
+    }
+    return encoding;
+}
+
+// Characteristic BDD of "var == value" in the encoding.
+static BDDNode* mddCodeBDD(const vector<string>& bits, int value) {
+    BDDNode* code = BDD_ONE;
+    for (size_t b = 0; b < bits.size(); ++b) {
+        BDDNode* literal = ((value >> b) & 1) ? makeNode(bits[b], BDD_ZERO, BDD_ONE) : makeNode(bits[b], BDD_ONE, BDD_ZERO);
+        code = apply(code, literal, AndOp);
+    }
+    return code;
+}
+
+static BDDNode* mddToBDDRec(MDDNode* f, const MDDEncoding& encoding, map<int, BDDNode*>& memo) {
+    if (isMDDTerminal(f)) return f == MDD_ONE ? BDD_ONE : BDD_ZERO;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+
+    const vector<string>& bits = encoding.bits.at(f->variable);
+    BDDNode* result = BDD_ZERO;
+    for (size_t v = 0; v < f->children.size(); ++v) {
+        BDDNode* child = mddToBDDRec(f->children[v], encoding, memo);
+        if (child != BDD_ZERO) result = apply(result, apply(mddCodeBDD(bits, (int)v), child, AndOp), OrOp);
+    }
+    memo[f->id] = result;
+    return result;
+}
+
+// Codes outside a variable's domain map to 0 only on paths that test the variable. A
+// variable an MDD node skips (all its children are equal) leaves its code bits free, so
+// there its out-of-domain codes take the value of the rest of the path.
+BDDNode* mddToBDD(MDDNode* f, const MDDEncoding& encoding) {
+    map<int, BDDNode*> memo;
+    return mddToBDDRec(f, encoding, memo);
+}
+
+static MDDNode* bddToMDDRec(BDDNode* f, size_t index, const MDDEncoding& encoding,
+                            map<pair<int, size_t>, MDDNode*>& memo) {
+    if (f == BDD_ZERO) return MDD_ZERO;
+    if (f == BDD_ONE) return MDD_ONE;
+    if (index == mddVariableOrder.size()) return nullptr;  // depends on a variable outside the encoding
+
+    pair<int, size_t> key = make_pair(f->id, index);
+    auto it = memo.find(key);
+    if (it != memo.end()) return it->second;
+
+    const string& var = mddVariableOrder[index];
+    auto bits = encoding.bits.find(var);
+    if (bits == encoding.bits.end()) return bddToMDDRec(f, index + 1, encoding, memo);  // f cannot test var
+
+    // nullptr below means "depends on a variable outside the encoding"; it never reaches mddMakeNode.
+    vector<MDDNode*> children;
+    MDDNode* result = nullptr;
+    for (int v = 0; v < mddDomain[var]; ++v) {
+        BDDNode* cofactor = f;
+        for (size_t b = 0; b < bits->second.size(); ++b) cofactor = bddRestrict(cofactor, bits->second[b], (v >> b) & 1);
+        MDDNode* child = bddToMDDRec(cofactor, index + 1, encoding, memo);
+        if (!child) break;
+        children.push_back(child);
+    }
+    if ((int)children.size() == mddDomain[var]) result = mddMakeNode(var, children);
+    memo[key] = result;
+    return result;
+}
+
+// Fails when f depends on BDD variables that encode no MDD variable. Codes outside a
+// variable's domain are ignored.
+bool bddToMDD(BDDNode* f, const MDDEncoding& encoding, MDDNode*& result) {
+    if (!MDD_ZERO) resetMDDTables();
+    map<pair<int, size_t>, MDDNode*> memo;
+    MDDNode* root = bddToMDDRec(f, 0, encoding, memo);
+    if (!root) return false;
+    result = root;
+    return true;
+}
+
+// -------------------------------- LUT Mapping --------------------------------------//
+// Ashenhurst-Curtis decomposition driven by BDD cuts. For a bound set made of the top b
+// support variables, the distinct nodes just below the cut are the distinct columns of
+// the decomposition chart, so their count is the column multiplicity mu. The bound set
+// is replaced by r = ceil(log2 mu) encoding functions (each one LUT over the bound set),
+// which become fresh variables of the remaining function, and the process repeats until
+// every function fits in a k-input LUT. Without a profitable cut the top variable is
+// split off with a Shannon mux instead.
+
+struct LUT {
+    string output;
+    vector<string> inputs;
+    vector<bool> truthTable;  // bit i of the row index is the value of inputs[i]
+};
+
+struct LUTNetwork {
+    vector<string> inputs;
+    vector<LUT> luts;
+    vector<pair<string, string>> outputs;  // output name -> driving signal
+};
+
+// Support variables of f, topmost first.
+vector<string> bddSupport(BDDNode* f) {
+    set<int> levels;
+    for (BDDNode* node : collectNodes({f})) {
+        if (!isTerminal(node)) levels.insert(getVariableIndex(node->variable));
+    }
+    vector<string> support;
+    for (int level : levels) support.push_back(manager->variableOrder[level]);
+    return support;
+}
+
+// Follows f through the variables in `vars` (bit i of assignment = vars[i]) until it
+// reaches a node below `cutLevel`.
+static BDDNode* walkAboveCut(BDDNode* f, const map<string, int>& position, unsigned assignment, int cutLevel) {
+    while (!isTerminal(f) && getVariableIndex(f->variable) <= cutLevel)
+        f = ((assignment >> position.at(f->variable)) & 1) ? f->high : f->low;
+    return f;
+}
+
+// Distinct nodes directly below the cut, in first-reached order.
+static vector<BDDNode*> cutCofactors(BDDNode* f, int cutLevel) {
+    vector<BDDNode*> cofactors;
+    set<int> seen;
+    vector<BDDNode*> stack = {f};
+    while (!stack.empty()) {
+        BDDNode* node = stack.back();
+        stack.pop_back();
+        if (seen.count(node->id)) continue;
+        seen.insert(node->id);
+        if (isTerminal(node) || getVariableIndex(node->variable) > cutLevel) {
+            cofactors.push_back(node);
+            continue;
+        }
+        stack.push_back(node->high);
+        stack.push_back(node->low);
+    }
+    return cofactors;
+}
+
+class LUTMapper {
+private:
+    int k;
+    LUTNetwork& network;
+    map<int, string> signalOf;  // BDD node id -> signal computing it
+    int counter = 0;
+
+    string freshName(const string& base) { return base + to_string(counter++); }
+
+    string emitLUT(BDDNode* f, const vector<string>& vars) {
+        map<string, int> position;
+        for (size_t i = 0; i < vars.size(); ++i) position[vars[i]] = (int)i;
+
+        LUT lut;
+        lut.output = freshName("lut");
+        lut.inputs = vars;
+        for (unsigned m = 0; m < (1u << vars.size()); ++m)
+            lut.truthTable.push_back(walkAboveCut(f, position, m, (int)manager->variableOrder.size()) == BDD_ONE);
+        network.luts.push_back(lut);
+        return lut.output;
+    }
+
+public:
+    LUTMapper(int lutInputs, LUTNetwork& net) : k(max(lutInputs, 3)), network(net) {}
+
+    string mapFunction(BDDNode* f) {
+        auto it = signalOf.find(f->id);
+        if (it != signalOf.end()) return it->second;
+
+        string signal;
+        vector<string> support = bddSupport(f);
+        if (!isTerminal(f) && f->low == BDD_ZERO && f->high == BDD_ONE) {
+            signal = f->variable;
+        } else if ((int)support.size() <= k) {
+            signal = emitLUT(f, support);
+        } else {
+            signal = decompose(f, support);
+        }
+        signalOf[f->id] = signal;
+        return signal;
+    }
+
+    string decompose(BDDNode* f, const vector<string>& support) {
+        int bestBound = 0, bestWidth = 0, bestGain = 0;
+        for (int b = 2; b <= k && b < (int)support.size(); ++b) {
+            size_t mu = cutCofactors(f, getVariableIndex(support[b - 1])).size();
+            int width = 0;
+            while (((size_t)1 << width) < mu) ++width;
+            // A tie keeps the smaller bound set found first, which also needs fewer encoding
+            // functions for the same gain.
+            if (b - width > bestGain) {
+                bestBound = b;
+                bestWidth = width;
+                bestGain = b - width;
+            }
+        }
+
+        if (bestGain <= 0) {
+            // Shannon split on the top variable: f = x ? f1 : f0
+            const string& x = support[0];
+            string s0 = mapFunction(bddRestrict(f, x, false));
+            string s1 = mapFunction(bddRestrict(f, x, true));
+            LUT mux;
+            mux.output = freshName("mux");
+            mux.inputs = {x, s0, s1};
+            for (unsigned m = 0; m < 8; ++m) mux.truthTable.push_back((m & 1) ? (m >> 2) & 1 : (m >> 1) & 1);
+            network.luts.push_back(mux);
+            return mux.output;
+        }
+
+        vector<string> bound(support.begin(), support.begin() + bestBound);
+        int cutLevel = getVariableIndex(bound.back());
+        vector<BDDNode*> cofactors = cutCofactors(f, cutLevel);
+        map<int, int> codeOf;
+        for (size_t c = 0; c < cofactors.size(); ++c) codeOf[cofactors[c]->id] = (int)c;
+
+        map<string, int> position;
+        for (size_t i = 0; i < bound.size(); ++i) position[bound[i]] = (int)i;
+
+        // Encoding functions alpha_j(bound) = bit j of the code of the column reached.
+        vector<int> columnCode;
+        for (unsigned m = 0; m < (1u << bound.size()); ++m)
+            columnCode.push_back(codeOf[walkAboveCut(f, position, m, cutLevel)->id]);
+
+        vector<string> alphas;
+        int alphaLevel = getVariableIndex(support[0]);
+        for (int j = 0; j < bestWidth; ++j) {
+            LUT alpha;
+            alpha.output = freshName("alpha");
+            alpha.inputs = bound;
+            for (int code : columnCode) alpha.truthTable.push_back((code >> j) & 1);
+            network.luts.push_back(alpha);
+            alphas.push_back(alpha.output);
+            newVarAtLevel(alphaLevel + j, alpha.output);
+        }
+
+        // Image function g(alpha, free) = column selected by the code.
+        BDDNode* g = BDD_ZERO;
+        for (size_t c = 0; c < cofactors.size(); ++c) {
+            BDDNode* term = cofactors[c];
+            for (int j = 0; j < bestWidth; ++j) {
+                BDDNode* literal = ((c >> j) & 1) ? makeNode(alphas[j], BDD_ZERO, BDD_ONE)
+                                                  : makeNode(alphas[j], BDD_ONE, BDD_ZERO);
+                term = apply(term, literal, AndOp);
+            }
+            g = apply(g, term, OrOp);
+        }
+        return mapFunction(g);
+    }
+};
+
+// Maps every output to k-input LUTs (k >= 3). The outputs are copied into a scratch manager
+// where each encoding function becomes a new variable right above the bound set it
+// replaces; the caller's order and nodes are left untouched.
+LUTNetwork mapToLUTs(const vector<pair<string, BDDNode*>>& outputs, int k) {
+    LUTNetwork network;
+    network.inputs = manager->variableOrder;
+
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    setVariableOrder(network.inputs);
+    map<int, BDDNode*> imported;
+    LUTMapper mapper(k, network);
+    for (const auto& out : outputs) {
+        BDDNode* f = importNode(out.second, imported);
+        if (isTerminal(f)) {
+            LUT constant;
+            constant.output = out.first + "_const";
+            constant.truthTable.push_back(f == BDD_ONE);
+            network.luts.push_back(constant);
+            network.outputs.push_back(make_pair(out.first, constant.output));
+            continue;
+        }
+        network.outputs.push_back(make_pair(out.first, mapper.mapFunction(f)));
+    }
+    return network;
+}
+
+string lutNetworkToBLIF(const LUTNetwork& network, const string& model = "robdd") {
+    stringstream blif;
+    blif << ".model " << model << "\n.inputs";
+    for (const string& in : network.inputs) blif << " " << in;
+    blif << "\n.outputs";
+    for (const auto& out : network.outputs) blif << " " << out.first;
+    blif << "\n";
+
+    for (const LUT& lut : network.luts) {
+        blif << ".names";
+        for (const string& in : lut.inputs) blif << " " << in;
+        blif << " " << lut.output << "\n";
+        for (size_t m = 0; m < lut.truthTable.size(); ++m) {
+            if (!lut.truthTable[m]) continue;
+            for (size_t i = 0; i < lut.inputs.size(); ++i) blif << (((m >> i) & 1) ? '1' : '0');
+            blif << (lut.inputs.empty() ? "1\n" : " 1\n");
+        }
+    }
+    for (const auto& out : network.outputs) {
+        if (out.first != out.second) blif << ".names " << out.second << " " << out.first << "\n1 1\n";
+    }
+    blif << ".end\n";
+    return blif.str();
+}
+
+// -------------------------------- Kronecker Functional Decision Diagrams --------------------------------------//
+// Each variable is decomposed with one of three expansions:
+//   Shannon:          f = !x & f0  |  x & f1      (low = f0, high = f1)
+//   positive Davio:   f = f0 ^ x & (f0 ^ f1)      (low = f0, high = f0 ^ f1)
+//   negative Davio:   f = f1 ^ !x & (f0 ^ f1)     (low = f1, high = f0 ^ f1)
+// Shannon nodes are reduced when low == high, Davio nodes when high == 0. Either way a
+// missing variable means "independent of x", so KFDDs share the BDD variable order and
+// can be converted level by level. All three expansions are linear over XOR, so the
+// f0 ^ f1 they need is computed on KFDD nodes without touching the BDD tables.
+// XOR-dominated logic is often far smaller as KFDD.
+
+enum class Decomposition { Shannon, PositiveDavio, NegativeDavio };
+
+// A node keeps the expansion it was built with, so changing a variable's type later does
+// not change what existing nodes mean.
+struct KFDDNode {
+    int id;
+    string variable;
+    Decomposition type;
+    KFDDNode* low;
+    KFDDNode* high;
+
+    KFDDNode(string var, Decomposition t, KFDDNode* l, KFDDNode* h) : variable(var), type(t), low(l), high(h) {
+        static int counter = 0;
+        id = counter++;
+        memCharge(MEM_NODES, (int64_t)(sizeof(KFDDNode) + stringHeapBytes(variable)));
+    }
+
+    ~KFDDNode() { memCharge(MEM_NODES, -(int64_t)(sizeof(KFDDNode) + stringHeapBytes(variable))); }
+};
+
+KFDDNode* KFDD_ZERO = nullptr;
+KFDDNode* KFDD_ONE = nullptr;
+
+map<string, Decomposition> decompositionType;  // missing variables use Shannon
+map<pair<pair<string, int>, pair<int, int>>, KFDDNode*> kfddUniqueTable;  // (var, type), (low, high)
+
+// Frees every KFDD node; roots taken before are dangling afterwards. The terminals stay.
+void resetKFDDTables() {
+    for (const auto& entry : kfddUniqueTable) delete entry.second;
+    kfddUniqueTable.clear();
+    if (!KFDD_ZERO) {
+        KFDD_ZERO = new KFDDNode("0", Decomposition::Shannon, nullptr, nullptr);
+        KFDD_ONE  = new KFDDNode("1", Decomposition::Shannon, nullptr, nullptr);
+    }
+}
+
+inline bool isKFDDTerminal(KFDDNode* n) { return n == KFDD_ZERO || n == KFDD_ONE; }
+
+Decomposition getDecomposition(const string& var) {
+    auto it = decompositionType.find(var);
+    return it == decompositionType.end() ? Decomposition::Shannon : it->second;
+}
+
+KFDDNode* kfddMakeNode(const string& var, KFDDNode* low, KFDDNode* high) {
+    Decomposition type = getDecomposition(var);
+    if (type == Decomposition::Shannon) {
+        if (low == high) return low;
+    } else if (high == KFDD_ZERO) {
+        return low;
+    }
+
+    auto key = make_pair(make_pair(var, (int)type), make_pair(low->id, high->id));
+    auto it = kfddUniqueTable.find(key);
+    if (it != kfddUniqueTable.end()) return it->second;
+
+    KFDDNode* node = new KFDDNode(var, type, low, high);
+    kfddUniqueTable[key] = node;
+    return node;
+}
+
+// Memo entries stay valid only while the types of the operands' variables do not change.
+using KFDDXorMemo = map<pair<int, int>, KFDDNode*>;
+
+static int kfddLevel(KFDDNode* n) {
+    return isKFDDTerminal(n) ? (int)manager->variableOrder.size() : getVariableIndex(n->variable);
+}
+
+// Works child by child in every expansion; an operand that does not test the top
+// variable is its own Shannon cofactor, or its own constant part with a zero linear part.
+static KFDDNode* kfddXor(KFDDNode* a, KFDDNode* b, KFDDXorMemo& memo) {
+    if (a == KFDD_ZERO) return b;
+    if (b == KFDD_ZERO) return a;
+    if (a == b) return KFDD_ZERO;
+    if (a->id > b->id) swap(a, b);
+
+    pair<int, int> key = make_pair(a->id, b->id);
+    auto it = memo.find(key);
+    if (it != memo.end()) return it->second;
+
+    int aLevel = kfddLevel(a), bLevel = kfddLevel(b);
+    const string& var = aLevel <= bLevel ? a->variable : b->variable;
+    KFDDNode* independentHigh = getDecomposition(var) == Decomposition::Shannon ? nullptr : KFDD_ZERO;
+    KFDDNode* a0 = aLevel <= bLevel ? a->low : a;
+    KFDDNode* a1 = aLevel <= bLevel ? a->high : (independentHigh ? independentHigh : a);
+    KFDDNode* b0 = bLevel <= aLevel ? b->low : b;
+    KFDDNode* b1 = bLevel <= aLevel ? b->high : (independentHigh ? independentHigh : b);
+
+    KFDDNode* result = kfddMakeNode(var, kfddXor(a0, b0, memo), kfddXor(a1, b1, memo));
+    memo[key] = result;
+    return result;
+}
+
+// The KFDD node of a BDD node on var whose cofactors convert to f0 and f1.
+static KFDDNode* kfddExpand(const string& var, KFDDNode* f0, KFDDNode* f1, KFDDXorMemo& xorMemo) {
+    switch (getDecomposition(var)) {
+        case Decomposition::Shannon:
+            return kfddMakeNode(var, f0, f1);
+        case Decomposition::PositiveDavio:
+            return kfddMakeNode(var, f0, kfddXor(f0, f1, xorMemo));
+        default:
+            return kfddMakeNode(var, f1, kfddXor(f0, f1, xorMemo));
+    }
+}
+
+static KFDDNode* kfddFromBDDRec(BDDNode* f, map<int, KFDDNode*>& memo, KFDDXorMemo& xorMemo) {
+    if (isTerminal(f)) return f == BDD_ONE ? KFDD_ONE : KFDD_ZERO;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+
+    KFDDNode* result = kfddExpand(f->variable, kfddFromBDDRec(f->low, memo, xorMemo),
+                                  kfddFromBDDRec(f->high, memo, xorMemo), xorMemo);
+    memo[f->id] = result;
+    return result;
+}
+
+// Converts using the current decompositionType of every variable.
+KFDDNode* kfddFromBDD(BDDNode* f) {
+    if (!KFDD_ZERO) resetKFDDTables();
+    map<int, KFDDNode*> memo;
+    KFDDXorMemo xorMemo;
+    return kfddFromBDDRec(f, memo, xorMemo);
+}
+
+static BDDNode* kfddToBDDRec(KFDDNode* n, map<int, BDDNode*>& memo) {
+    if (isKFDDTerminal(n)) return n == KFDD_ONE ? BDD_ONE : BDD_ZERO;
+
+    auto it = memo.find(n->id);
+    if (it != memo.end()) return it->second;
+
+    BDDNode* low = kfddToBDDRec(n->low, memo);
+    BDDNode* high = kfddToBDDRec(n->high, memo);
+    BDDNode* result;
+    switch (n->type) {
+        case Decomposition::Shannon:
+            result = makeNode(n->variable, low, high);
+            break;
+        case Decomposition::PositiveDavio:
+            result = makeNode(n->variable, low, apply(low, high, XorOp));
+            break;
+        default:
+            result = makeNode(n->variable, apply(low, high, XorOp), low);
+            break;
+    }
+    memo[n->id] = result;
+    return result;
+}
+
+BDDNode* kfddToBDD(KFDDNode* n) {
+    map<int, BDDNode*> memo;
+    return kfddToBDDRec(n, memo);
+}
+
+static bool kfddEvaluateRec(KFDDNode* n, const map<string, bool>& values, map<int, bool>& memo) {
+    if (isKFDDTerminal(n)) return n == KFDD_ONE;
+
+    auto it = memo.find(n->id);
+    if (it != memo.end()) return it->second;
+
+    bool x = values.at(n->variable);
+    bool result;
+    switch (n->type) {
+        case Decomposition::Shannon:
+            result = kfddEvaluateRec(x ? n->high : n->low, values, memo);
+            break;
+        case Decomposition::PositiveDavio:
+            result = kfddEvaluateRec(n->low, values, memo) ^ (x && kfddEvaluateRec(n->high, values, memo));
+            break;
+        default:
+            result = kfddEvaluateRec(n->low, values, memo) ^ (!x && kfddEvaluateRec(n->high, values, memo));
+            break;
+    }
+    memo[n->id] = result;
+    return result;
+}
+
+bool kfddEvaluate(KFDDNode* n, const map<string, bool>& values) {
+    map<int, bool> memo;
+    return kfddEvaluateRec(n, values, memo);
+}
+
+size_t kfddSize(const vector<KFDDNode*>& roots) {
+    set<int> visited;
+    vector<KFDDNode*> stack(roots.begin(), roots.end());
+    while (!stack.empty()) {
+        KFDDNode* n = stack.back();
+        stack.pop_back();
+        if (isKFDDTerminal(n) || visited.count(n->id)) continue;
+        visited.insert(n->id);
+        stack.push_back(n->low);
+        stack.push_back(n->high);
+    }
+    return visited.size();
+}
+
+// Greedy decomposition type choice: starting from all-Shannon, visits the variables
+// bottom-up and keeps, for each, the expansion that gives the fewest KFDD nodes over all
+// roots. Returns the final size. While the levels above are still Shannon they convert
+// one KFDD node per BDD node whatever happens below, so a level is scored by converting
+// only its own nodes (deeper levels are already final) and counting the KFDD nodes
+// reachable from the BDD nodes that the upper levels or the roots point to.
+// Refuses to run while KFDD nodes are live, since it rewrites the types they were built
+// for; the trial nodes it builds are freed before it returns.
+bool chooseDecompositionTypes(const vector<BDDNode*>& roots, size_t& size) {
+    if (!KFDD_ZERO) resetKFDDTables();
+    if (!kfddUniqueTable.empty()) return false;
+    for (const string& var : manager->variableOrder) decompositionType.erase(var);
+
+    int numLevels = (int)manager->variableOrder.size();
+    vector<BDDNode*> nodes = collectNodes(roots);
+    vector<vector<BDDNode*>> byLevel(numLevels);
+    map<int, int> topParentLevel;  // BDD node id -> level of its highest parent, -1 for roots
+    for (BDDNode* root : roots) {
+        if (root && !isTerminal(root)) topParentLevel[root->id] = -1;
+    }
+    for (BDDNode* node : nodes) {
+        if (isTerminal(node)) continue;
+        int level = getVariableIndex(node->variable);
+        byLevel[level].push_back(node);
+        for (BDDNode* child : {node->low, node->high}) {
+            auto it = topParentLevel.find(child->id);
+            if (it == topParentLevel.end()) topParentLevel[child->id] = level;
+            else it->second = min(it->second, level);
+        }
+    }
+
+    map<int, KFDDNode*> converted;
+    KFDDXorMemo xorMemo;
+    auto convertedChild = [&](BDDNode* child) {
+        return isTerminal(child) ? (child == BDD_ONE ? KFDD_ONE : KFDD_ZERO) : converted.at(child->id);
+    };
+
+    size_t upperNodes = 0;
+    for (const auto& levelNodes : byLevel) upperNodes += levelNodes.size();
+    size_t best = upperNodes;
+    for (int level = numLevels - 1; level >= 0; --level) {
+        const string& var = manager->variableOrder[level];
+        upperNodes -= byLevel[level].size();
+        if (byLevel[level].empty()) continue;
+
+        // BDD nodes at or below this level that the upper levels or the roots point to.
+        vector<BDDNode*> cut;
+        for (int l = level; l < numLevels; ++l) {
+            for (BDDNode* node : byLevel[l]) {
+                if (topParentLevel.at(node->id) < level) cut.push_back(node);
+            }
+        }
+
+        Decomposition chosen = Decomposition::Shannon;
+        vector<KFDDNode*> chosenNodes;
+        for (Decomposition type : {Decomposition::Shannon, Decomposition::PositiveDavio, Decomposition::NegativeDavio}) {
+            decompositionType[var] = type;
+            vector<KFDDNode*> levelNodes;
+            for (BDDNode* node : byLevel[level]) {
+                levelNodes.push_back(kfddExpand(var, convertedChild(node->low), convertedChild(node->high), xorMemo));
+                converted[node->id] = levelNodes.back();
+            }
+            vector<KFDDNode*> cutNodes;
+            for (BDDNode* node : cut) cutNodes.push_back(converted.at(node->id));
+            size_t trial = upperNodes + kfddSize(cutNodes);
+            if (type == Decomposition::Shannon || trial < best) {
+                best = trial;
+                chosen = type;
+                chosenNodes = levelNodes;
+            }
+        }
+        decompositionType[var] = chosen;
+        for (size_t i = 0; i < byLevel[level].size(); ++i) converted[byLevel[level][i]->id] = chosenNodes[i];
+    }
+    resetKFDDTables();
+    size = best;
+    return true;
+}
+
+// -------------------------------- Binary Moment Diagrams --------------------------------------//
+// *BMDs represent integer-valued functions of Boolean variables through the moment
+// decomposition f = f0 + x * (f1 - f0): a node's low edge is the constant moment and its
+// high edge the linear moment. Weights sit on the edges and are normalized so that the
+// children's weights are coprime with the sign carried by the low edge, which makes the
+// representation canonical. Word-level arithmetic such as A * B stays linear in size, so
+// multipliers can be checked by backward substitution through the gate netlist, which no
+// BDD variable order can do.
+
+using BMDWeight = __int128;
+
+struct BMDNode;
+
+struct BMDEdge {
+    BMDWeight weight;
+    BMDNode* node;
+
+    bool operator==(const BMDEdge& other) const { return weight == other.weight && node == other.node; }
+    bool operator!=(const BMDEdge& other) const { return !(*this == other); }
+};
+
+struct BMDNode {
+    int id;
+    string variable;
+    BMDEdge low;
+    BMDEdge high;
+
+    BMDNode(string var, BMDEdge l, BMDEdge h) : variable(var), low(l), high(h) {
+        static int counter = 0;
+        id = counter++;
+        memCharge(MEM_NODES, (int64_t)(sizeof(BMDNode) + stringHeapBytes(variable)));
+    }
+};
+
+BMDNode* BMD_ONE = nullptr;  // the only terminal; constants are weights on edges to it
+
+vector<string> bmdVariableOrder;
+map<string, int> bmdLevel;
+map<pair<string, pair<pair<BMDWeight, int>, pair<BMDWeight, int>>>, BMDNode*> bmdUniqueTable;
+map<pair<pair<BMDWeight, int>, pair<BMDWeight, int>>, BMDEdge> bmdAddCache;
+map<pair<int, int>, BMDEdge> bmdMulCache;
+
+// Existing BMDs are only valid for the order they were built under, so this resets the tables.
+void setBMDVariableOrder(const vector<string>& vars) {
+    bmdVariableOrder = vars;
+    bmdLevel.clear();
+    for (int i = 0; i < (int)vars.size(); i++) bmdLevel[vars[i]] = i;
+    bmdUniqueTable.clear();
+    bmdAddCache.clear();
+    bmdMulCache.clear();
+    BMD_ONE = new BMDNode("1", BMDEdge{0, nullptr}, BMDEdge{0, nullptr});
+}
+
+inline BMDEdge bmdConstant(BMDWeight c) { return BMDEdge{c, BMD_ONE}; }
+
+// The variable must be in the BMD order; bmdFromNetlist checks that for every signal.
+static int bmdVariableLevel(const string& var) {
+    auto it = bmdLevel.find(var);
+    if (it == bmdLevel.end()) {
+        cerr << "BMD variable " << var << " is not in the BMD order" << endl;
+        abort();
+    }
+    return it->second;
+}
+
+inline int bmdNodeLevel(BMDNode* n) {
+    if (n == BMD_ONE) return (int)bmdVariableOrder.size();
+    return bmdVariableLevel(n->variable);
+}
+
+static BMDWeight bmdGcd(BMDWeight a, BMDWeight b) {
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+    while (b != 0) {
+        BMDWeight t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+BMDEdge bmdScale(BMDEdge e, BMDWeight c) {
+    if (c == 0 || e.weight == 0) return bmdConstant(0);
+    return BMDEdge{e.weight * c, e.node};
+}
+
+BMDEdge bmdMakeEdge(const string& var, BMDEdge low, BMDEdge high) {
+    if (high.weight == 0) return low;
+
+    BMDWeight g = bmdGcd(low.weight, high.weight);
+    if (low.weight < 0 || (low.weight == 0 && high.weight < 0)) g = -g;
+    low.weight /= g;
+    high.weight /= g;
+    if (low.weight == 0) low.node = BMD_ONE;
+
+    auto key = make_pair(var, make_pair(make_pair(low.weight, low.node->id), make_pair(high.weight, high.node->id)));
+    auto it = bmdUniqueTable.find(key);
+    if (it != bmdUniqueTable.end()) return BMDEdge{g, it->second};
+
+    BMDNode* node = new BMDNode(var, low, high);
+    bmdUniqueTable[key] = node;
+    return BMDEdge{g, node};
+}
+
+BMDEdge bmdVariable(const string& var) {
+    bmdVariableLevel(var);
+    return bmdMakeEdge(var, bmdConstant(0), bmdConstant(1));
+}
+
+// Constant and linear moments of e with respect to the variable at `level`.
+static void bmdCofactors(BMDEdge e, int level, BMDEdge& low, BMDEdge& high) {
+    if (e.weight == 0 || bmdNodeLevel(e.node) != level) {
+        low = e;
+        high = bmdConstant(0);
+        return;
+    }
+    low = bmdScale(e.node->low, e.weight);
+    high = bmdScale(e.node->high, e.weight);
+}
+
+BMDEdge bmdAdd(BMDEdge a, BMDEdge b) {
+    if (a.weight == 0) return b;
+    if (b.weight == 0) return a;
+    if (a.node == BMD_ONE && b.node == BMD_ONE) return bmdConstant(a.weight + b.weight);
+
+    // Cache on the weight ratio so that k*a + k*b hits the entry for a + b.
+    BMDWeight g = bmdGcd(a.weight, b.weight);
+    auto key = make_pair(make_pair(a.weight / g, a.node->id), make_pair(b.weight / g, b.node->id));
+    auto it = bmdAddCache.find(key);
+    if (it != bmdAddCache.end()) return bmdScale(it->second, g);
+
+    int level = min(bmdNodeLevel(a.node), bmdNodeLevel(b.node));
+    BMDEdge unitA = BMDEdge{a.weight / g, a.node};
+    BMDEdge unitB = BMDEdge{b.weight / g, b.node};
+    BMDEdge aLow, aHigh, bLow, bHigh;
+    bmdCofactors(unitA, level, aLow, aHigh);
+    bmdCofactors(unitB, level, bLow, bHigh);
+    BMDEdge result = bmdMakeEdge(bmdVariableOrder[level], bmdAdd(aLow, bLow), bmdAdd(aHigh, bHigh));
+
+    bmdAddCache[key] = result;
+    return bmdScale(result, g);
+}
+
+BMDEdge bmdSub(BMDEdge a, BMDEdge b) {
+    return bmdAdd(a, bmdScale(b, -1));
+}
+
+// (a0 + x a1)(b0 + x b1) = a0 b0 + x (a0 b1 + a1 b0 + a1 b1), using x * x = x.
+BMDEdge bmdMul(BMDEdge a, BMDEdge b) {
+    if (a.weight == 0 || b.weight == 0) return bmdConstant(0);
+    if (a.node == BMD_ONE) return bmdScale(b, a.weight);
+    if (b.node == BMD_ONE) return bmdScale(a, b.weight);
+
+    BMDWeight weight = a.weight * b.weight;
+    pair<int, int> key = make_pair(min(a.node->id, b.node->id), max(a.node->id, b.node->id));
+    auto it = bmdMulCache.find(key);
+    if (it != bmdMulCache.end()) return bmdScale(it->second, weight);
+
+    int level = min(bmdNodeLevel(a.node), bmdNodeLevel(b.node));
+    BMDEdge a0, a1, b0, b1;
+    bmdCofactors(BMDEdge{1, a.node}, level, a0, a1);
+    bmdCofactors(BMDEdge{1, b.node}, level, b0, b1);
+    BMDEdge linear = bmdAdd(bmdAdd(bmdMul(a0, b1), bmdMul(a1, b0)), bmdMul(a1, b1));
+    BMDEdge result = bmdMakeEdge(bmdVariableOrder[level], bmdMul(a0, b0), linear);
+
+    bmdMulCache[key] = result;
+    return bmdScale(result, weight);
+}
+
+static BMDEdge bmdRestrictRec(BMDEdge e, int level, bool value, map<int, BMDEdge>& memo) {
+    if (e.weight == 0 || bmdNodeLevel(e.node) > level) return e;
+
+    BMDEdge unit;
+    auto it = memo.find(e.node->id);
+    if (it != memo.end()) {
+        unit = it->second;
+    } else {
+        BMDNode* n = e.node;
+        if (bmdNodeLevel(n) == level) {
+            unit = value ? bmdAdd(n->low, n->high) : n->low;
+        } else {
+            unit = bmdMakeEdge(n->variable, bmdRestrictRec(n->low, level, value, memo),
+                               bmdRestrictRec(n->high, level, value, memo));
+        }
+        memo[n->id] = unit;
+    }
+    return bmdScale(unit, e.weight);
+}
+
+BMDEdge bmdRestrict(BMDEdge e, const string& var, bool value) {
+    map<int, BMDEdge> memo;
+    return bmdRestrictRec(e, bmdVariableLevel(var), value, memo);
+}
+
+// F with var replaced by the 0/1-valued function g: F|0 + g * (F|1 - F|0).
+BMDEdge bmdCompose(BMDEdge f, const string& var, BMDEdge g) {
+    BMDEdge f0 = bmdRestrict(f, var, false);
+    BMDEdge f1 = bmdRestrict(f, var, true);
+    return bmdAdd(f0, bmdMul(g, bmdSub(f1, f0)));
+}
+
+// Arithmetic form of a gate over the BMDs of its 0/1-valued inputs.
+BMDEdge bmdGate(const Gate& gate) {
+    vector<BMDEdge> in;
+    for (const string& name : gate.inputs) in.push_back(bmdVariable(name));
+    if (in.empty()) return bmdConstant(0);
+
+    string type = gate.type;
+    transform(type.begin(), type.end(), type.begin(), ::tolower);
+
+    BMDEdge result = in[0];
+    if (type == "not") return bmdSub(bmdConstant(1), result);
+    for (size_t i = 1; i < in.size(); ++i) {
+        BMDEdge product = bmdMul(result, in[i]);
+        if (type == "and" || type == "nand") result = product;
+        else if (type == "or" || type == "nor") result = bmdSub(bmdAdd(result, in[i]), product);
+        else if (type == "xor") result = bmdSub(bmdAdd(result, in[i]), bmdScale(product, 2));
+    }
+    if (type == "nand" || type == "nor") result = bmdSub(bmdConstant(1), result);
+    return result;
+}
+
+// sum_i 2^i * bits[i]
+BMDEdge bmdWord(const vector<string>& bits) {
+    BMDEdge word = bmdConstant(0);
+    for (size_t i = 0; i < bits.size(); ++i) word = bmdAdd(word, bmdScale(bmdVariable(bits[i]), (BMDWeight)1 << i));
+    return word;
+}
+
+// Word-level function of the primary inputs computed by the output bits `outWord`
+// (least significant first), by substituting gates from the outputs back to the inputs.
+// Resets the BMD tables: internal signals are ordered above the inputs, latest gate on top.
+// Fails, leaving the tables alone, when an output bit or a gate in its cone reads a signal
+// that is neither an input nor driven by a gate.
+bool bmdFromNetlist(const vector<Gate>& gates, const vector<string>& inputs, const vector<string>& outWord,
+                    BMDEdge& result) {
+    map<string, size_t> driver;
+    set<string> inputSet(inputs.begin(), inputs.end());
+    for (size_t i = 0; i < gates.size(); ++i) {
+        if (!inputSet.count(gates[i].output)) driver.insert(make_pair(gates[i].output, i));
+    }
+
+    // Topological order of the gates in the output cones (fanins first).
+    auto undriven = [&](const string& signal) { return !inputSet.count(signal) && !driver.count(signal); };
+    vector<size_t> topo;
+    vector<GateState> state(gates.size(), GATE_PENDING);
+    for (const string& out : outWord) {
+        if (undriven(out)) return false;
+        auto root = driver.find(out);
+        if (root == driver.end() || state[root->second] != GATE_PENDING) continue;
+        vector<pair<size_t, size_t>> stack = {make_pair(root->second, (size_t)0)};
+        state[root->second] = GATE_ACTIVE;
+        while (!stack.empty()) {
+            size_t g = stack.back().first;
+            if (stack.back().second < gates[g].inputs.size()) {
+                const string& input = gates[g].inputs[stack.back().second++];
+                if (undriven(input)) return false;
+                auto it = driver.find(input);
+                if (it != driver.end() && state[it->second] == GATE_PENDING) {
+                    state[it->second] = GATE_ACTIVE;
+                    stack.push_back(make_pair(it->second, (size_t)0));
+                }
+                continue;
+            }
+            stack.pop_back();
+            state[g] = GATE_DONE;
+            topo.push_back(g);
+        }
+    }
+
+    vector<string> order;
+    for (auto it = topo.rbegin(); it != topo.rend(); ++it) order.push_back(gates[*it].output);
+    for (const string& in : inputs) order.push_back(in);
+    setBMDVariableOrder(order);
+
+    BMDEdge f = bmdWord(outWord);
+    for (auto it = topo.rbegin(); it != topo.rend(); ++it) f = bmdCompose(f, gates[*it].output, bmdGate(gates[*it]));
+    result = f;
+    return true;
+}
+
+// Signals named prefix<number>, sorted by number.
+vector<string> signalsWithPrefix(const vector<string>& signals, const string& prefix) {
+    vector<pair<int, string>> found;
+    for (const string& s : signals) {
+        if (s.size() <= prefix.size() || s.compare(0, prefix.size(), prefix) != 0) continue;
+        string digits = s.substr(prefix.size());
+        if (all_of(digits.begin(), digits.end(), ::isdigit)) found.push_back(make_pair(stoi(digits), s));
+    }
+    sort(found.begin(), found.end());
+    vector<string> result;
+    for (const auto& f : found) result.push_back(f.second);
+    return result;
+}
+
+// Checks that the output word equals A * B, with all three words given as bit-name prefixes
+// (e.g. "a", "b", "p" for a0.., b0.., p0..). Weights are 128-bit, so words up to about 60
+// bits wide are exact.
+bool verifyMultiplier(const string& verilogCode, const string& aPrefix, const string& bPrefix, const string& pPrefix) {
+    VerilogParser parser;
+    if (!parser.parse(verilogCode)) return false;
+    vector<string> inputs = parser.getInputs();
+    vector<string> outputs = parser.getOutputs();
+    vector<string> a = signalsWithPrefix(inputs, aPrefix);
+    vector<string> b = signalsWithPrefix(inputs, bPrefix);
+    vector<string> p = signalsWithPrefix(outputs, pPrefix);
+    if (a.empty() || b.empty() || p.empty()) return false;
+
+    BMDEdge circuit{0, nullptr};
+    if (!bmdFromNetlist(parser.getGates(), inputs, p, circuit)) {
+        cerr << "The product bits read an undriven signal" << endl;
+        return false;
+    }
+    BMDEdge spec = bmdMul(bmdWord(a), bmdWord(b));
+    return circuit == spec;
+}
+
+// -------------------------------- CTL Model Checking --------------------------------------//
+// Symbolic CTL over the registers of a sequential design (see cutRegisters). Each register
+// q gets a next-state variable "q_next" right below it in the order, and the transition
+// relation T(s, s') = AND_q (q_next <-> d_q) has the inputs quantified away. Registers
+// start at 0. Atoms are signal names; a signal that depends on inputs holds in a state
+// when some input makes it true.
+
+BDDNode* bddVariable(const string& var) {
+    return makeNode(var, BDD_ZERO, BDD_ONE);
+}
+
+static int bddLevel(BDDNode* f) {
+    return isTerminal(f) ? (int)manager->variableOrder.size() : getVariableIndex(f->variable);
+}
+
+static set<int> levelsOf(const vector<string>& vars) {
+    set<int> levels;
+    for (const string& var : vars) levels.insert(getVariableIndex(var));
+    return levels;
+}
+
+static BDDNode* bddExistsRec(BDDNode* f, const set<int>& levels, map<int, BDDNode*>& memo) {
+    if (isTerminal(f) || bddLevel(f) > *levels.rbegin()) return f;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+    BDDNode* low = bddExistsRec(f->low, levels, memo);
+    BDDNode* high = bddExistsRec(f->high, levels, memo);
+    BDDNode* result = levels.count(bddLevel(f)) ? apply(low, high, OrOp) : makeNode(f->variable, low, high);
+    memo[f->id] = result;
+    return result;
+}
+
+// f with every variable of vars existentially quantified.
+BDDNode* bddExists(BDDNode* f, const vector<string>& vars) {
+    if (vars.empty()) return f;
+    map<int, BDDNode*> memo;
+    return bddExistsRec(f, levelsOf(vars), memo);
+}
+
+static BDDNode* bddAndExistsRec(BDDNode* f, BDDNode* g, const set<int>& levels, map<pair<int, int>, BDDNode*>& memo) {
+    if (f == BDD_ZERO || g == BDD_ZERO) return BDD_ZERO;
+    if (f == BDD_ONE && g == BDD_ONE) return BDD_ONE;
+
+    pair<int, int> key = make_pair(f->id, g->id);
+    auto it = memo.find(key);
+    if (it != memo.end()) return it->second;
+
+    int level = min(bddLevel(f), bddLevel(g));
+    string var = bddLevel(f) == level ? f->variable : g->variable;
+    BDDNode* f0 = bddLevel(f) == level ? f->low : f;
+    BDDNode* f1 = bddLevel(f) == level ? f->high : f;
+    BDDNode* g0 = bddLevel(g) == level ? g->low : g;
+    BDDNode* g1 = bddLevel(g) == level ? g->high : g;
+
+    BDDNode* result;
+    BDDNode* low = bddAndExistsRec(f0, g0, levels, memo);
+    if (levels.count(level)) {
+        result = low == BDD_ONE ? BDD_ONE : apply(low, bddAndExistsRec(f1, g1, levels, memo), OrOp);
+    } else {
+        result = makeNode(var, low, bddAndExistsRec(f1, g1, levels, memo));
+    }
+    memo[key] = result;
+    return result;
+}
+
+// Relational product: exists vars . f AND g, without building the conjunction first.
+BDDNode* bddAndExists(BDDNode* f, BDDNode* g, const vector<string>& vars) {
+    if (vars.empty()) return apply(f, g, AndOp);
+    map<pair<int, int>, BDDNode*> memo;
+    return bddAndExistsRec(f, g, levelsOf(vars), memo);
+}
+
+static BDDNode* bddRenameRec(BDDNode* f, const map<string, string>& names, map<int, BDDNode*>& memo) {
+    if (isTerminal(f)) return f;
+
+    auto it = memo.find(f->id);
+    if (it != memo.end()) return it->second;
+    auto renamed = names.find(f->variable);
+    BDDNode* var = bddVariable(renamed == names.end() ? f->variable : renamed->second);
+    BDDNode* low = bddRenameRec(f->low, names, memo);
+    BDDNode* high = bddRenameRec(f->high, names, memo);
+    BDDNode* result = apply(apply(var, high, AndOp), apply(bddNot(var), low, AndOp), OrOp);
+    memo[f->id] = result;
+    return result;
+}
+
+// f with variables substituted by name; works for any target order.
+BDDNode* bddRename(BDDNode* f, const map<string, string>& names) {
+    map<int, BDDNode*> memo;
+    return bddRenameRec(f, names, memo);
+}
+
+struct TransitionSystem {
+    vector<string> stateVars;
+    vector<string> nextVars;          // nextVars[i] is the next-state copy of stateVars[i]
+    vector<string> inputVars;
+    BDDNode* trans = nullptr;         // over stateVars and nextVars
+    BDDNode* init = nullptr;
+    map<string, BDDNode*> labels;     // atom -> states where it holds
+    vector<BDDNode*> nextFunctions;   // next-state function of stateVars[i], inputs not quantified
+    vector<pair<string, BDDNode*>> outputFunctions;  // inputs not quantified
+};
+
+TransitionSystem buildTransitionSystem(const string& verilogCode) {
+    TransitionSystem ts;
+    ROBDDBuilder builder;
+    vector<pair<string, BDDNode*>> nextState = builder.buildSequential(verilogCode);
+
+    set<string> registers;
+    for (const auto& ns : nextState) registers.insert(ns.first);
+    for (const string& in : builder.getParserInputs()) {
+        if (!registers.count(in)) ts.inputVars.push_back(in);
+    }
+
+    ts.trans = BDD_ONE;
+    ts.init = BDD_ONE;
+    for (const auto& ns : nextState) {
+        string next = ns.first + "_next";
+        newVarAtLevel(getVariableIndex(ns.first) + 1, next);
+        ts.stateVars.push_back(ns.first);
+        ts.nextVars.push_back(next);
+        BDDNode* same = bddNot(apply(bddVariable(next), ns.second, XorOp));
+        ts.trans = apply(ts.trans, same, AndOp);
+        ts.init = apply(ts.init, bddNot(bddVariable(ns.first)), AndOp);
+        ts.nextFunctions.push_back(ns.second);
+    }
+    ts.trans = bddExists(ts.trans, ts.inputVars);
+    ts.outputFunctions = builder.getOutputBDDs();
+
+    for (const auto& signal : builder.getParserSignalBDDs())
+        ts.labels[signal.first] = bddExists(signal.second, ts.inputVars);
+    return ts;
+}
+
+// op is an atom name's marker "atom", a constant "true"/"false", a connective "!", "&", "|",
+// "->", or a temporal operator "EX", "AX", "EF", "AF", "EG", "AG", "EU", "AU".
+struct CTLFormula {
+    string op;
+    string atom;
+    vector<CTLFormula> args;
+};
+
+// Grammar, loosest first: f -> f | f | f & f | !f | EX f ... AG f | E[f U f] | A[f U f]
+// | (f) | TRUE | FALSE | signal. Implication is right-associative.
+class CTLParser {
+private:
+    string text;
+    size_t pos = 0;
+
+    void skipSpace() {
+        while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+    }
+
+    bool accept(const string& token) {
+        skipSpace();
+        if (text.compare(pos, token.size(), token) != 0) return false;
+        pos += token.size();
+        return true;
+    }
+
+    string peekWord() {
+        skipSpace();
+        size_t end = pos;
+        while (end < text.size() && (isalnum((unsigned char)text[end]) || text[end] == '_' || text[end] == '.')) end++;
+        return text.substr(pos, end - pos);
+    }
+
+    bool parseImplication(CTLFormula& f) {
+        if (!parseOr(f)) return false;
+        if (!accept("->")) return true;
+        CTLFormula rhs;
+        if (!parseImplication(rhs)) return false;
+        f = CTLFormula{"->", "", {f, rhs}};
+        return true;
+    }
+
+    bool parseOr(CTLFormula& f) {
+        if (!parseAnd(f)) return false;
+        while (accept("|")) {
+            CTLFormula rhs;
+            if (!parseAnd(rhs)) return false;
+            f = CTLFormula{"|", "", {f, rhs}};
+        }
+        return true;
+    }
+
+    bool parseAnd(CTLFormula& f) {
+        if (!parseUnary(f)) return false;
+        while (accept("&")) {
+            CTLFormula rhs;
+            if (!parseUnary(rhs)) return false;
+            f = CTLFormula{"&", "", {f, rhs}};
+        }
+        return true;
+    }
+
+    bool parseUnary(CTLFormula& f) {
+        if (accept("!")) {
+            CTLFormula arg;
+            if (!parseUnary(arg)) return false;
+            f = CTLFormula{"!", "", {arg}};
+            return true;
+        }
+        if (accept("(")) return parseImplication(f) && accept(")");
+
+        string word = peekWord();
+        if (word.empty()) return false;
+        pos += word.size();
+
+        if ((word == "E" || word == "A") && accept("[")) {
+            CTLFormula lhs, rhs;
+            if (!parseImplication(lhs) || peekWord() != "U") return false;
+            pos++;
+            if (!parseImplication(rhs) || !accept("]")) return false;
+            f = CTLFormula{word + "U", "", {lhs, rhs}};
+            return true;
+        }
+        for (const char* op : {"EX", "AX", "EF", "AF", "EG", "AG"}) {
+            if (word != op) continue;
+            CTLFormula arg;
+            if (!parseUnary(arg)) return false;
+            f = CTLFormula{word, "", {arg}};
+            return true;
+        }
+        if (word == "TRUE" || word == "FALSE") f = CTLFormula{word == "TRUE" ? "true" : "false", "", {}};
+        else f = CTLFormula{"atom", word, {}};
+        return true;
+    }
+
+public:
+    bool parse(const string& formula, CTLFormula& result) {
+        text = formula;
+        pos = 0;
+        if (!parseImplication(result)) return false;
+        skipSpace();
+        return pos == text.size();
+    }
+};
+
+// One state of a non-empty set, as a full valuation of stateVars (unconstrained variables
+// are 0); cube receives that state as a BDD.
+map<string, bool> pickOneState(BDDNode* states, const vector<string>& stateVars, BDDNode*& cube) {
+    map<string, bool> values;
+    for (const string& var : stateVars) values[var] = false;
+    for (BDDNode* n = states; !isTerminal(n);) {
+        bool high = n->low == BDD_ZERO;
+        values[n->variable] = high;
+        n = high ? n->high : n->low;
+    }
+    cube = BDD_ONE;
+    for (auto it = stateVars.rbegin(); it != stateVars.rend(); ++it) {
+        BDDNode* var = bddVariable(*it);
+        cube = apply(cube, values[*it] ? var : bddNot(var), AndOp);
+    }
+    return values;
+}
+
+struct CTLStats {
+    int fixpoints = 0;
+    int iterations = 0;          // fixpoint steps over all fixpoints
+    int preImages = 0;
+    int peakFrontierNodes = 0;   // largest frontier (newly added states) seen by a least fixpoint
+};
+
+// A path of register valuations. When loopStart >= 0 the path ends in a cycle back to
+// states[loopStart] (EG witnesses and AF counterexamples).
+struct CTLTrace {
+    vector<map<string, bool>> states;
+    int loopStart = -1;
+};
+
+class CTLChecker {
+private:
+    TransitionSystem ts;
+    vector<BDDNode*> fairness;   // state sets that fair paths visit infinitely often
+    BDDNode* fairStates = nullptr;
+    CTLStats stats;
+    string error;
+
+    BDDNode* conj(BDDNode* f, BDDNode* g) { return apply(f, g, AndOp); }
+    BDDNode* disj(BDDNode* f, BDDNode* g) { return apply(f, g, OrOp); }
+
+    BDDNode* fair() {
+        if (!fairStates) fairStates = fairness.empty() ? BDD_ONE : egFair(BDD_ONE);
+        return fairStates;
+    }
+
+    // Least fixpoint of E[f U g]. rings, when given, receives the frontiers: rings[k] holds
+    // the states whose shortest path to g takes k steps. Only the frontier is kept per step,
+    // and the rings are dropped as soon as a trace has been read off them.
+    BDDNode* euPlain(BDDNode* f, BDDNode* g, vector<BDDNode*>* rings) {
+        stats.fixpoints++;
+        BDDNode* reached = g;
+        BDDNode* frontier = g;
+        if (rings) rings->assign(1, g);
+        while (frontier != BDD_ZERO) {
+            stats.iterations++;
+            stats.peakFrontierNodes = max(stats.peakFrontierNodes, (int)collectNodes({frontier}).size() - 2);
+            frontier = conj(conj(f, preImage(frontier)), bddNot(reached));
+            if (frontier == BDD_ZERO) break;
+            reached = disj(reached, frontier);
+            if (rings) rings->push_back(frontier);
+        }
+        return reached;
+    }
+
+    // Greatest fixpoint of EG f under the fairness constraints (Emerson-Lei).
+    BDDNode* egFair(BDDNode* f) {
+        stats.fixpoints++;
+        BDDNode* z = f;
+        while (true) {
+            stats.iterations++;
+            BDDNode* next = f;
+            if (fairness.empty()) {
+                next = conj(next, preImage(z));
+            } else {
+                for (BDDNode* constraint : fairness) next = conj(next, preImage(euPlain(f, conj(z, constraint), nullptr)));
+            }
+            if (next == z) return z;
+            z = next;
+        }
+    }
+
+    BDDNode* satEX(BDDNode* f) { return preImage(conj(f, fair())); }
+    BDDNode* satEU(BDDNode* f, BDDNode* g) { return euPlain(f, conj(g, fair()), nullptr); }
+
+    map<string, bool> pickState(BDDNode* states, BDDNode*& cube) { return pickOneState(states, ts.stateVars, cube); }
+
+    // Walks down the rings from a state in rings[k] to one in rings[0], appending states.
+    BDDNode* followRings(BDDNode* state, const vector<BDDNode*>& rings, CTLTrace& trace) {
+        int k = 0;
+        while (k < (int)rings.size() && conj(state, rings[k]) == BDD_ZERO) k++;
+        if (k == (int)rings.size()) return state;
+        for (--k; k >= 0; --k) {
+            trace.states.push_back(pickState(conj(image(state), rings[k]), state));
+        }
+        return state;
+    }
+
+    void witnessEU(BDDNode* f, BDDNode* g, BDDNode* start, CTLTrace& trace) {
+        vector<BDDNode*> rings;
+        euPlain(f, conj(g, fair()), &rings);
+        followRings(start, rings, trace);
+    }
+
+    // Lasso inside EG f: visits every fairness set, then closes a cycle. When the cycle
+    // cannot be closed, the walk takes one step inside z and starts over from there. Every
+    // state of z has a successor in z, and a loop state that cannot be reached again is
+    // never revisited, so each restart begins in a strictly later strongly connected
+    // component of z.
+    void witnessEG(BDDNode* f, BDDNode* start, CTLTrace& trace) {
+        BDDNode* z = egFair(f);
+        BDDNode* state = start;
+        while (true) {
+            int loopIndex = (int)trace.states.size() - 1;
+            BDDNode* loopState = state;
+            for (BDDNode* constraint : fairness) {
+                vector<BDDNode*> rings;
+                euPlain(z, conj(z, constraint), &rings);
+                state = followRings(state, rings, trace);
+            }
+
+            // Back to loopState in at least one step.
+            vector<BDDNode*> rings;
+            BDDNode* reach = euPlain(z, loopState, &rings);
+            BDDNode* successors = conj(image(state), reach);
+            if (successors != BDD_ZERO) {
+                BDDNode* next;
+                map<string, bool> values = pickState(successors, next);
+                if (next != loopState) {
+                    trace.states.push_back(values);
+                    followRings(next, rings, trace);
+                    trace.states.pop_back();  // that is loopState again, i.e. states[loopIndex]
+                }
+                trace.loopStart = loopIndex;
+                return;
+            }
+            BDDNode* inside = conj(image(state), z);
+            if (inside == BDD_ZERO) return;  // start was not in EG f
+            trace.states.push_back(pickState(inside, state));
+        }
+    }
+
+    bool witness(const CTLFormula& f, BDDNode* start, CTLTrace& trace) {
+        if (f.op == "EX") {
+            BDDNode* next;
+            trace.states.push_back(pickState(conj(image(start), conj(sat(f.args[0]), fair())), next));
+        } else if (f.op == "EF") {
+            witnessEU(BDD_ONE, sat(f.args[0]), start, trace);
+        } else if (f.op == "EU") {
+            witnessEU(sat(f.args[0]), sat(f.args[1]), start, trace);
+        } else if (f.op == "EG") {
+            witnessEG(sat(f.args[0]), start, trace);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+public:
+    CTLChecker(const TransitionSystem& system, const vector<BDDNode*>& fairnessSets = vector<BDDNode*>())
+        : ts(system), fairness(fairnessSets) {}
+
+    // EX without fairness: states with a successor in `states`.
+    BDDNode* preImage(BDDNode* states) {
+        stats.preImages++;
+        map<string, string> toNext;
+        for (size_t i = 0; i < ts.stateVars.size(); ++i) toNext[ts.stateVars[i]] = ts.nextVars[i];
+        return bddAndExists(ts.trans, bddRename(states, toNext), ts.nextVars);
+    }
+
+    BDDNode* image(BDDNode* states) {
+        map<string, string> toCurrent;
+        for (size_t i = 0; i < ts.stateVars.size(); ++i) toCurrent[ts.nextVars[i]] = ts.stateVars[i];
+        return bddRename(bddAndExists(ts.trans, states, ts.stateVars), toCurrent);
+    }
+
+    // States satisfying f under the fairness constraints; nullptr for unknown atoms.
+    BDDNode* sat(const CTLFormula& f) {
+        const string& op = f.op;
+        if (op == "true") return BDD_ONE;
+        if (op == "false") return BDD_ZERO;
+        if (op == "atom") {
+            auto it = ts.labels.find(f.atom);
+            if (it != ts.labels.end()) return it->second;
+            error = "unknown signal " + f.atom;
+            return nullptr;
+        }
+
+        vector<BDDNode*> args;
+        for (const CTLFormula& arg : f.args) {
+            args.push_back(sat(arg));
+            if (!args.back()) return nullptr;
+        }
+        if (op == "!") return bddNot(args[0]);
+        if (op == "&") return conj(args[0], args[1]);
+        if (op == "|") return disj(args[0], args[1]);
+        if (op == "->") return disj(bddNot(args[0]), args[1]);
+        if (op == "EX") return satEX(args[0]);
+        if (op == "AX") return bddNot(satEX(bddNot(args[0])));
+        if (op == "EF") return satEU(BDD_ONE, args[0]);
+        if (op == "AF") return bddNot(egFair(bddNot(args[0])));
+        if (op == "EG") return egFair(args[0]);
+        if (op == "AG") return bddNot(satEU(BDD_ONE, bddNot(args[0])));
+        if (op == "EU") return satEU(args[0], args[1]);
+        if (op == "AU") {
+            BDDNode* notF = bddNot(args[0]);
+            BDDNode* notG = bddNot(args[1]);
+            return bddNot(disj(satEU(notG, conj(notF, notG)), egFair(notG)));
+        }
+        error = "unknown operator " + op;
+        return nullptr;
+    }
+
+    // Whether f holds in the initial state. A trace is produced for a top-level temporal
+    // operator: a witness when an E-formula holds, a counterexample (a witness of the
+    // dual E-formula) when an A-formula fails.
+    bool check(const CTLFormula& f, CTLTrace* trace = nullptr) {
+        error.clear();
+        BDDNode* states = sat(f);
+        if (!states) return false;
+        bool holds = conj(ts.init, bddNot(states)) == BDD_ZERO;
+        if (!trace) return holds;
+
+        *trace = CTLTrace();
+        BDDNode* start;
+        CTLFormula dual;
+        if (holds && f.op[0] == 'E') {
+            dual = f;
+        } else if (!holds && f.op == "AX") {
+            dual = CTLFormula{"EX", "", {CTLFormula{"!", "", {f.args[0]}}}};
+        } else if (!holds && f.op == "AG") {
+            dual = CTLFormula{"EF", "", {CTLFormula{"!", "", {f.args[0]}}}};
+        } else if (!holds && f.op == "AF") {
+            dual = CTLFormula{"EG", "", {CTLFormula{"!", "", {f.args[0]}}}};
+        } else if (!holds && f.op == "AU") {
+            CTLFormula notF{"!", "", {f.args[0]}};
+            CTLFormula notG{"!", "", {f.args[1]}};
+            dual = CTLFormula{"EG", "", {notG}};
+            if (conj(ts.init, sat(dual)) == BDD_ZERO)
+                dual = CTLFormula{"EU", "", {notG, CTLFormula{"&", "", {notF, notG}}}};
+        } else {
+            return holds;
+        }
+
+        trace->states.push_back(pickState(conj(ts.init, sat(dual)), start));
+        witness(dual, start, *trace);
+        return holds;
+    }
+
+    const CTLStats& getStats() const { return stats; }
+    const string& getError() const { return error; }
+    const vector<string>& getStateVars() const { return ts.stateVars; }
+};
+
+// -------------------------------- FSM State Minimization --------------------------------------//
+// Two states are equivalent when every input gives the same outputs and equivalent
+// successors. The relation E(s, t) lives on the registers and a second copy "<q>_pair" (with
+// its own "<q>_pair_next"), interleaved per register so that equality stays linear, and
+// is refined as a greatest fixpoint:
+//   E0(s, t)      = forall i . outputs(s, i) == outputs(t, i)
+//   E{k+1}(s, t)  = Ek(s, t) and forall i . exists s', t' . T(s, i, s') T(t, i, t') Ek(s', t')
+// The reachable classes are then given a binary code, and the quotient is again a
+// TransitionSystem, so reachability and CTL run on the smaller machine unchanged.
+
+struct StateMinimization {
+    BDDNode* equivalence = nullptr;   // E(s, t) over stateVars and their _pair copies
+    vector<BDDNode*> classes;         // reachable equivalence classes, over stateVars
+    double reachableStates = 0;
+    int iterations = 0;
+    TransitionSystem quotient;        // one state per class; labels are the outputs
+};
+
+static BDDNode* reachableStates(const TransitionSystem& ts) {
+    CTLChecker checker(ts);
+    BDDNode* reached = ts.init;
+    BDDNode* frontier = ts.init;
+    while (frontier != BDD_ZERO) {
+        frontier = apply(checker.image(frontier), bddNot(reached), AndOp);
+        reached = apply(reached, frontier, OrOp);
+    }
+    return reached;
+}
+
+// Works in the manager that holds ts: the _pair copies and the state_c code bits are
+// registered there as new variables, and the result's BDDs live there too. Nothing is
+// reset or rebuilt, so the caller's other BDDs stay valid.
+StateMinimization minimizeStates(const TransitionSystem& ts) {
+    StateMinimization result;
+    size_t n = ts.stateVars.size();
+
+    vector<string> pairVars, pairNextVars;
+    map<string, string> toPair, toNext;
+    for (size_t i = 0; i < n; ++i) {
+        pairVars.push_back(ts.stateVars[i] + "_pair");
+        pairNextVars.push_back(ts.stateVars[i] + "_pair_next");
+        newVarAtLevel(getVariableIndex(ts.stateVars[i]) + 1, pairVars[i]);
+        newVarAtLevel(getVariableIndex(ts.nextVars[i]) + 1, pairNextVars[i]);
+        toPair[ts.stateVars[i]] = pairVars[i];
+        toPair[ts.nextVars[i]] = pairNextVars[i];
+        toNext[ts.stateVars[i]] = ts.nextVars[i];
+        toNext[pairVars[i]] = pairNextVars[i];
+    }
+
+    // Both copies step on the same input.
+    BDDNode* trans = BDD_ONE;
+    for (size_t i = 0; i < n; ++i)
+        trans = apply(trans, bddNot(apply(bddVariable(ts.nextVars[i]), ts.nextFunctions[i], XorOp)), AndOp);
+    BDDNode* pairTrans = apply(trans, bddRename(trans, toPair), AndOp);
+    vector<string> allNext = ts.nextVars;
+    allNext.insert(allNext.end(), pairNextVars.begin(), pairNextVars.end());
+
+    BDDNode* differ = BDD_ZERO;
+    for (const auto& out : ts.outputFunctions)
+        differ = apply(differ, apply(out.second, bddRename(out.second, toPair), XorOp), OrOp);
+    BDDNode* equivalence = bddNot(bddExists(differ, ts.inputVars));
+
+    while (true) {
+        result.iterations++;
+        BDDNode* successorsEquivalent = bddAndExists(pairTrans, bddRename(equivalence, toNext), allNext);
+        BDDNode* refined = apply(equivalence, bddNot(bddExists(bddNot(successorsEquivalent), ts.inputVars)), AndOp);
+        if (refined == equivalence) break;
+        equivalence = refined;
+    }
+    result.equivalence = equivalence;
+
+    // Split the reachable states into classes, one symbolic step per class.
+    BDDNode* remaining = reachableStates(ts);
+    vector<double> count = parallelSatCount({remaining});
+    result.reachableStates = ldexp(count[0], -(int)(manager->variableOrder.size() - n));
+    map<string, string> fromPair;
+    for (size_t i = 0; i < n; ++i) fromPair[pairVars[i]] = ts.stateVars[i];
+    while (remaining != BDD_ZERO) {
+        BDDNode* state;
+        pickOneState(remaining, ts.stateVars, state);
+        BDDNode* partners = bddRename(bddAndExists(state, equivalence, ts.stateVars), fromPair);
+        BDDNode* cls = apply(partners, remaining, AndOp);
+        result.classes.push_back(cls);
+        remaining = apply(remaining, bddNot(cls), AndOp);
+    }
+
+    // Quotient machine over code bits state_c<k>, each followed by its _next copy.
+    TransitionSystem& q = result.quotient;
+    int bits = 1;
+    while (((size_t)1 << bits) < result.classes.size()) bits++;
+    for (int b = 0; b < bits; ++b) {
+        q.stateVars.push_back("state_c" + to_string(b));
+        q.nextVars.push_back("state_c" + to_string(b) + "_next");
+        newVarAtLevel((int)manager->variableOrder.size(), q.stateVars.back());
+        newVarAtLevel((int)manager->variableOrder.size(), q.nextVars.back());
+    }
+
+    BDDNode* encoding = BDD_ZERO;  // Enc(s, c)
+    for (size_t k = 0; k < result.classes.size(); ++k) {
+        BDDNode* code = BDD_ONE;
+        for (int b = 0; b < bits; ++b) {
+            BDDNode* var = bddVariable(q.stateVars[b]);
+            code = apply(code, (k >> b) & 1 ? var : bddNot(var), AndOp);
+        }
+        encoding = apply(encoding, apply(result.classes[k], code, AndOp), OrOp);
+    }
+    map<string, string> encodingToNext;
+    for (size_t i = 0; i < n; ++i) encodingToNext[ts.stateVars[i]] = ts.nextVars[i];
+    for (int b = 0; b < bits; ++b) encodingToNext[q.stateVars[b]] = q.nextVars[b];
+    BDDNode* nextEncoding = bddRename(encoding, encodingToNext);
+
+    // Equivalent states agree on outputs and successor classes, so the quotient stays
+    // deterministic per input and keeps the inputs.
+    q.inputVars = ts.inputVars;
+    BDDNode* quotientTrans = bddAndExists(encoding, bddAndExists(trans, nextEncoding, ts.nextVars), ts.stateVars);
+    q.trans = bddExists(quotientTrans, q.inputVars);
+    q.init = bddAndExists(ts.init, encoding, ts.stateVars);
+    for (int b = 0; b < bits; ++b)
+        q.nextFunctions.push_back(bddAndExists(quotientTrans, bddVariable(q.nextVars[b]), q.nextVars));
+    for (const auto& out : ts.outputFunctions) {
+        BDDNode* output = bddAndExists(encoding, out.second, ts.stateVars);
+        q.outputFunctions.push_back(make_pair(out.first, output));
+        q.labels[out.first] = bddExists(output, q.inputVars);
+    }
+    return result;
+}
+
+// -------------------------------- NPN Canonical Forms --------------------------------------//
+// Two functions are NPN-equivalent when one becomes the other by negating inputs, permuting
+// inputs and negating the output. The canonical form is the smallest truth table over the
+// transforms that survive signature pruning: the output phase is fixed by the number of
+// ones, each input's phase by its two cofactor satcounts, and inputs are sorted by those
+// counts, so only ties are enumerated. The signatures are NPN-invariant, which keeps the
+// result canonical unless the tie enumeration hits NPN_MAX_CANDIDATES.
+
+const int NPN_MAX_INPUTS = 10;
+const size_t NPN_MAX_CANDIDATES = 20000;
+
+// Bit x of the table is f at the assignment whose bit i is input i.
+struct TruthTable {
+    int numVars = 0;
+    vector<uint64_t> words;
+
+    bool get(uint32_t x) const { return (words[x >> 6] >> (x & 63)) & 1; }
+    void set(uint32_t x) { words[x >> 6] |= uint64_t(1) << (x & 63); }
+    bool operator<(const TruthTable& other) const {
+        return numVars != other.numVars ? numVars < other.numVars : words < other.words;
+    }
+    bool operator==(const TruthTable& other) const { return numVars == other.numVars && words == other.words; }
+};
+
+static TruthTable emptyTruthTable(int numVars) {
+    TruthTable tt;
+    tt.numVars = numVars;
+    tt.words.assign(max<size_t>(1, ((size_t)1 << numVars) / 64), 0);
+    return tt;
+}
+
+// f over `inputs` (input i is bit i); variables outside inputs must not occur in f.
+TruthTable bddToTruthTable(BDDNode* f, const vector<string>& inputs) {
+    TruthTable tt = emptyTruthTable((int)inputs.size());
+    map<string, int> position;
+    for (size_t i = 0; i < inputs.size(); ++i) position[inputs[i]] = (int)i;
+    for (uint32_t x = 0; x < ((uint32_t)1 << inputs.size()); ++x) {
+        BDDNode* n = f;
+        while (!isTerminal(n)) n = (x >> position[n->variable]) & 1 ? n->high : n->low;
+        if (n == BDD_ONE) tt.set(x);
+    }
+    return tt;
+}
+
+// Canonical input i is original input perm[i], complemented when negated[perm[i]].
+struct NPNTransform {
+    vector<int> perm;
+    vector<bool> negated;
+    bool outputNegated = false;
+};
+
+struct NPNForm {
+    TruthTable canonical;
+    NPNTransform transform;     // takes the function to `canonical`
+    vector<string> support;     // the function's inputs, by level
+    bool exact = true;          // false when the candidate cap cut the enumeration short
+};
+
+static int popcount(const TruthTable& tt) {
+    int ones = 0;
+    for (uint64_t w : tt.words) ones += __builtin_popcountll(w);
+    return ones;
+}
+
+static TruthTable applyNPN(const TruthTable& tt, const NPNTransform& t) {
+    TruthTable result = emptyTruthTable(tt.numVars);
+    uint32_t inputFlips = 0;
+    for (int i = 0; i < tt.numVars; ++i) inputFlips |= (uint32_t)t.negated[i] << i;
+    for (uint32_t x = 0; x < ((uint32_t)1 << tt.numVars); ++x) {
+        uint32_t v = 0;
+        for (int i = 0; i < tt.numVars; ++i) v |= ((x >> i) & 1) << t.perm[i];
+        if (tt.get(v ^ inputFlips) != t.outputNegated) result.set(x);
+    }
+    return result;
+}
+
+NPNForm npnCanonicalize(const TruthTable& tt) {
+    int n = tt.numVars;
+    uint32_t size = (uint32_t)1 << n;
+    NPNForm best;
+    best.canonical.numVars = -1;
+    size_t candidates = 0;
+
+    int ones = popcount(tt);
+    for (bool outNeg : {false, true}) {
+        int phaseOnes = outNeg ? (int)size - ones : ones;
+        if (phaseOnes * 2 > (int)size) continue;  // keep the phase with fewer ones
+
+        // Per input: ones of the positive cofactor, and whether both phases tie.
+        vector<int> signature(n);
+        vector<bool> negated(n, false), tiedPhase(n, false);
+        for (int i = 0; i < n; ++i) {
+            int positive = 0;
+            for (uint32_t x = 0; x < size; ++x) positive += ((x >> i) & 1) && tt.get(x) != outNeg;
+            int negative = phaseOnes - positive;
+            negated[i] = positive > negative;
+            tiedPhase[i] = positive == negative;
+            signature[i] = min(positive, negative);
+        }
+
+        vector<int> order(n);
+        for (int i = 0; i < n; ++i) order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return signature[a] < signature[b]; });
+        vector<pair<int, int>> groups;  // [begin, end) runs of equal signature in order
+        for (int i = 0; i < n;) {
+            int j = i;
+            while (j < n && signature[order[j]] == signature[order[i]]) j++;
+            groups.push_back(make_pair(i, j));
+            i = j;
+        }
+        vector<int> tied;
+        for (int i = 0; i < n; ++i) {
+            if (tiedPhase[i]) tied.push_back(i);
+        }
+
+        // Odometer over the permutations of every group, times the tied phase choices.
+        vector<int> perm = order;
+        for (const auto& g : groups) sort(perm.begin() + g.first, perm.begin() + g.second);
+        while (true) {
+            for (uint32_t flips = 0; flips < ((uint32_t)1 << tied.size()); ++flips) {
+                if (++candidates > NPN_MAX_CANDIDATES) {
+                    best.exact = false;
+                    return best;
+                }
+                NPNTransform t{perm, negated, outNeg};
+                for (size_t k = 0; k < tied.size(); ++k) t.negated[tied[k]] = (flips >> k) & 1;
+                TruthTable candidate = applyNPN(tt, t);
+                if (best.canonical.numVars < 0 || candidate < best.canonical) {
+                    best.canonical = candidate;
+                    best.transform = t;
+                }
+            }
+            size_t g = 0;
+            while (g < groups.size() && !next_permutation(perm.begin() + groups[g].first, perm.begin() + groups[g].second))
+                g++;
+            if (g == groups.size()) break;
+        }
+    }
+    return best;
+}
+
+thread_local map<int, NPNForm> npnFormCache;  // node id -> form of the function rooted there
+
+// Memoized per node. Functions with more than NPN_MAX_INPUTS inputs get canonical.numVars == -1.
+const NPNForm& npnCanonicalForm(BDDNode* f) {
+    auto it = npnFormCache.find(f->id);
+    if (it != npnFormCache.end()) return it->second;
+
+    NPNForm form;
+    vector<string> support = bddSupport(f);
+    if ((int)support.size() > NPN_MAX_INPUTS) {
+        form.canonical.numVars = -1;
+    } else {
+        form = npnCanonicalize(bddToTruthTable(f, support));
+    }
+    form.support = support;
+    return npnFormCache[f->id] = form;
+}
+
+struct LibraryCell {
+    string name;
+    vector<string> pins;     // inputs the function depends on, in truth-table order
+    NPNForm form;
+};
+
+// A cell implementing f: pin j of the cell connects to `inputs[j]`, complemented when
+// inputNegated[j], and the cell output is complemented when outputNegated.
+struct CellMatch {
+    const LibraryCell* cell;
+    vector<string> inputs;
+    vector<bool> inputNegated;
+    bool outputNegated;
+};
+
+class CellLibrary {
+private:
+    vector<LibraryCell> cells;
+    map<TruthTable, vector<size_t>> index;   // canonical form -> cells
+
+public:
+    // A cell defined by a single-output Verilog module. The cell is built in a scratch
+    // manager and kept only as its canonical form, so the caller's BDDs and variable order
+    // are left as they were.
+    bool addCellFromVerilog(const string& name, const string& verilogCode) {
+        BDDManager scratch;
+        ManagerScope scope(scratch);
+        ROBDDBuilder builder;
+        BDDNode* f = builder.buildROBDD(verilogCode);
+        if (!f) return false;
+        LibraryCell cell;
+        cell.name = name;
+        cell.pins = bddSupport(f);
+        if ((int)cell.pins.size() > NPN_MAX_INPUTS) return false;
+        cell.form = npnCanonicalize(bddToTruthTable(f, cell.pins));
+        cell.form.support = cell.pins;
+        index[cell.form.canonical].push_back(cells.size());
+        cells.push_back(cell);
+        return true;
+    }
+
+    // Every `module name(...) ... endmodule` in the text becomes a cell. Returns the count.
+    int loadVerilog(const string& text) {
+        int added = 0;
+        size_t pos = 0;
+        while ((pos = text.find("module", pos)) != string::npos) {
+            size_t end = text.find("endmodule", pos);
+            if (end == string::npos) break;
+            string module = text.substr(pos, end + 9 - pos);
+            size_t open = module.find('(');
+            stringstream header(module.substr(6, open == string::npos ? string::npos : open - 6));
+            string name;
+            header >> name;
+            if (!name.empty() && addCellFromVerilog(name, module)) added++;
+            pos = end + 9;
+        }
+        return added;
+    }
+
+    size_t size() const { return cells.size(); }
+
+    vector<CellMatch> match(BDDNode* f) {
+        vector<CellMatch> matches;
+        if (isTerminal(f)) return matches;
+        const NPNForm& form = npnCanonicalForm(f);
+        if (form.canonical.numVars < 0) return matches;
+        auto it = index.find(form.canonical);
+        if (it == index.end()) return matches;
+
+        // f and the cell reach the same table, so cell pin pc[i] meets f input pf[i].
+        const NPNTransform& tf = form.transform;
+        for (size_t c : it->second) {
+            const LibraryCell& cell = cells[c];
+            const NPNTransform& tc = cell.form.transform;
+            CellMatch m{&cell, vector<string>(cell.pins.size()), vector<bool>(cell.pins.size()),
+                        tf.outputNegated != tc.outputNegated};
+            for (size_t i = 0; i < cell.pins.size(); ++i) {
+                m.inputs[tc.perm[i]] = form.support[tf.perm[i]];
+                m.inputNegated[tc.perm[i]] = tf.negated[tf.perm[i]] != tc.negated[tc.perm[i]];
+            }
+            matches.push_back(m);
+        }
+        return matches;
+    }
+};
+
+// -------------------------------- Self Checks --------------------------------------//
+// --self-check runs these and exits non-zero when one fails. Each compares two code paths
+// that must agree, on inputs large enough to take the paths that matter.
+
+// Node lambdas of a parallel fold run on threads whose manager is not the caller's; with
+// non-uniform input probabilities a wrong level shows up in every output.
+static bool selfCheckParallelProbability() {
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(12));
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+    if (collectNodes(roots).size() < PARALLEL_PASS_MIN_NODES) return false;
+
+    map<string, double> inputProb;
+    for (size_t l = 0; l < manager->variableOrder.size(); ++l) inputProb[manager->variableOrder[l]] = 0.1 + 0.8 * (double)((l * 7) % 10) / 9.0;
+    vector<double> parallel = parallelProbability(roots, inputProb, 4);
+    vector<double> sequential = parallelProbability(roots, inputProb, 1);
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (fabs(parallel[i] - sequential[i]) > 1e-12) return false;
+    }
+    return true;
+}
+
+// The upward fold of the sensitivity pass has the same hazard as the probability fold.
+static bool selfCheckParallelSensitivity() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(12));
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+
+    map<string, double> inputProb;
+    for (size_t l = 0; l < manager->variableOrder.size(); ++l) inputProb[manager->variableOrder[l]] = 0.1 + 0.8 * (double)((l * 3) % 10) / 9.0;
+    vector<vector<VariableSensitivity>> parallel = variableSensitivities(roots, inputProb, 4);
+    vector<vector<VariableSensitivity>> sequential = variableSensitivities(roots, inputProb, 1);
+    for (size_t o = 0; o < roots.size(); ++o) {
+        for (size_t l = 0; l < manager->variableOrder.size(); ++l) {
+            const VariableSensitivity& a = parallel[o][l];
+            const VariableSensitivity& b = sequential[o][l];
+            if (fabs(a.marginal - b.marginal) > 1e-12 || fabs(a.birnbaum - b.birnbaum) > 1e-12 ||
+                fabs(a.influence - b.influence) > 1e-12)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Every input of a parity function flips it, so its influence is 1 whatever the input
+// probabilities, while the Birnbaum importance nearly cancels out.
+static bool selfCheckParityInfluence() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateParity(12));
+    map<string, double> inputProb;
+    for (size_t l = 0; l < manager->variableOrder.size(); ++l) inputProb[manager->variableOrder[l]] = 0.2 + 0.05 * (double)l;
+    vector<vector<VariableSensitivity>> stats = variableSensitivities({builder.getOutputBDDs()[0].second}, inputProb);
+    for (const VariableSensitivity& s : stats[0]) {
+        if (fabs(s.influence - 1.0) > 1e-12 || fabs(s.birnbaum) > 1e-3) return false;
+    }
+    return true;
+}
+
+// A compact file read back must evaluate like the encoding it was written from; every
+// truncation must be rejected, and every single-byte corruption the reader accepts must
+// still decode within bounds (run under ASan to see the difference).
+static bool selfCheckCompactFile() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(6));
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+    CompactBDD original = compressBDD(roots);
+
+    char path[] = "/tmp/robdd-selfcheck-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    close(fd);
+    auto writeBytes = [&](const vector<uint8_t>& bytes) {
+        int out = open(path, O_WRONLY | O_TRUNC);
+        bool ok = out >= 0 && writeAllBytes(out, reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (out >= 0) close(out);
+        return ok;
+    };
+
+    bool ok = writeCompactBDDFile(path, original);
+    CompactBDD loaded;
+    ok = ok && readCompactBDDFile(path, loaded) && loaded.roots == original.roots;
+    vector<BDDNode*> decompressed;
+    ok = ok && decompressBDD(loaded, decompressed) && decompressed == roots;
+    vector<bool> levelValues(manager->variableOrder.size());
+    for (uint32_t trial = 0; ok && trial < 64; ++trial) {
+        for (size_t l = 0; l < levelValues.size(); ++l) levelValues[l] = ((trial * 40503u + (uint32_t)l * 2654435761u) >> 13) & 1;
+        for (uint32_t r = 0; r < original.roots.size(); ++r) {
+            if (evaluateCompact(loaded, r, levelValues) != evaluateCompact(original, r, levelValues)) ok = false;
+        }
+    }
+
+    vector<uint8_t> file;
+    if (ok) {
+        ifstream in(path, ios::binary);
+        file.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    for (size_t len = 0; ok && len < file.size(); ++len) {
+        CompactBDD truncated;
+        ok = writeBytes(vector<uint8_t>(file.begin(), file.begin() + len)) && !readCompactBDDFile(path, truncated);
+    }
+    for (size_t i = 0; ok && i < file.size(); ++i) {
+        for (uint8_t value : {(uint8_t)0x00, (uint8_t)0x01, (uint8_t)0x80, (uint8_t)0xff}) {
+            vector<uint8_t> corrupt = file;
+            corrupt[i] = value;
+            CompactBDD decoded;
+            if (!writeBytes(corrupt)) ok = false;
+            if (!ok || !readCompactBDDFile(path, decoded)) continue;
+            vector<bool> values(decoded.varNames.size());
+            for (uint32_t r = 0; r < decoded.roots.size(); ++r) evaluateCompact(decoded, r, values);
+        }
+    }
+    unlink(path);
+
+    // A pipe delivers the file in pieces and has no size to stat.
+    if (ok && mkfifo(path, 0600) == 0) {
+        thread writer([&]() {
+            int out = open(path, O_WRONLY);
+            if (out < 0) return;
+            size_t half = file.size() / 2;
+            writeAllBytes(out, reinterpret_cast<const char*>(file.data()), half);
+            this_thread::sleep_for(chrono::milliseconds(20));
+            writeAllBytes(out, reinterpret_cast<const char*>(file.data()) + half, file.size() - half);
+            close(out);
+        });
+        CompactBDD piped;
+        ok = readCompactBDDFile(path, piped) && piped.roots == original.roots;
+        writer.join();
+        unlink(path);
+    }
+
+    // Decompressing under another order must fail rather than build wrong nodes.
+    BDDManager scratch;
+    ManagerScope scope(scratch);
+    vector<string> reversed(original.varNames.rbegin(), original.varNames.rend());
+    setVariableOrder(reversed);
+    return ok && !decompressBDD(loaded, decompressed) && scratch.nodeTable.empty();
+}
+
+// Conversions that cannot be expressed must fail instead of handing back a null node.
+static bool selfCheckMDDErrors() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    newMDDVar("check_state", 3);
+    MDDEncoding encoding = encodeMDDVariables();
+
+    MDDNode* literal = nullptr;
+    if (mddLiteral("check_unknown", {0}, literal) || !mddLiteral("check_state", {0, 2}, literal)) return false;
+    BDDNode* encoded = mddToBDD(literal, encoding);
+    MDDNode* decoded = nullptr;
+    if (!bddToMDD(encoded, encoding, decoded) || decoded != literal) return false;
+
+    newVarAtLevel((int)manager->variableOrder.size(), "check_free");
+    BDDNode* outside = apply(encoded, makeNode("check_free", BDD_ZERO, BDD_ONE), AndOp);
+    return !bddToMDD(outside, encoding, decoded) && decoded == literal;
+}
+
+// A reorder must not strand live nodes on the wrong level, and must keep variable IDs.
+static bool selfCheckVariableOrder() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(4));
+    vector<string> order = manager->variableOrder;
+    vector<string> reversed(order.rbegin(), order.rend());
+    if (setVariableOrder(reversed) || manager->variableOrder != order || !setVariableOrder(order)) return false;
+
+    int id = newVarAtLevel(0, "check_extra");
+    resetBDDTables();
+    reversed.insert(reversed.begin() + 3, "check_extra");
+    return setVariableOrder(reversed) && newVarAtLevel(0, "check_extra") == id && getVariableIndex("check_extra") == 3;
+}
+
+// Too few or identical samples cannot show a slowdown; a clear one must still be flagged.
+static bool selfCheckSlowdownTest() {
+    return !significantSlowdown({1.0}, {2.0}, 0.05) && !significantSlowdown({1.0, 1.0}, {2.0, 2.0}, 0.05) &&
+           significantSlowdown({1.0, 1.1, 0.9, 1.0}, {2.0, 2.1, 1.9, 2.0}, 0.05) &&
+           !significantSlowdown({1.0, 1.1, 0.9, 1.0}, {1.0, 1.2, 0.8, 1.05}, 0.05);
+}
+
+// The incremental type choice must report the size a full conversion gives, convert back
+// to the same functions, and leave the BDD tables alone.
+static bool selfCheckKFDDTypes() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(5));
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+    BDDNode* parity = builder.getOutputBDDs()[0].second;
+    for (BDDNode* root : roots) parity = apply(parity, root, XorOp);
+    roots.push_back(parity);
+
+    size_t bddNodes = manager->nodeTable.size();
+    size_t chosen = 0;
+    if (!chooseDecompositionTypes(roots, chosen) || manager->nodeTable.size() != bddNodes) return false;
+
+    vector<KFDDNode*> converted;
+    for (BDDNode* root : roots) converted.push_back(kfddFromBDD(root));
+    if (kfddSize(converted) != chosen || chosen >= collectNodes(roots).size() - 2) return false;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (kfddToBDD(converted[i]) != roots[i]) return false;
+    }
+
+    // Choosing again is refused while the converted nodes are live, and they keep their meaning.
+    size_t again = 0;
+    if (chooseDecompositionTypes(roots, again)) return false;
+    for (size_t i = 0; i < roots.size(); ++i) {
+        if (kfddToBDD(converted[i]) != roots[i]) return false;
+    }
+    resetKFDDTables();
+    if (!chooseDecompositionTypes(roots, again) || again != chosen) return false;
+
+    // Same variable and children under two expansions: x as Shannon, !x as negative Davio.
+    const string& x = manager->variableOrder[0];
+    Decomposition kept = getDecomposition(x);
+    decompositionType[x] = Decomposition::Shannon;
+    KFDDNode* shannon = kfddMakeNode(x, KFDD_ZERO, KFDD_ONE);
+    decompositionType[x] = Decomposition::NegativeDavio;
+    KFDDNode* davio = kfddMakeNode(x, KFDD_ZERO, KFDD_ONE);
+    decompositionType[x] = kept;
+    bool distinct = shannon != davio && kfddEvaluate(shannon, {{x, true}}) && !kfddEvaluate(davio, {{x, true}});
+    resetKFDDTables();
+    return distinct;
+}
+
+// The initial state already satisfies the fairness constraint but has no path back to
+// itself, so the EG witness has to step on before it can close a cycle.
+static bool selfCheckFairEGWitness() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    TransitionSystem ts = buildTransitionSystem("module h(a, o);\ninput a;\noutput o;\nwire x, d, q;\n"
+                                                "xor(x, a, a);\nnot(d, x);\ndff(q, d);\nor(o, q, q);\nendmodule\n");
+    CTLChecker checker(ts, {BDD_ONE});
+    CTLTrace trace;
+    CTLFormula eg{"EG", "", {CTLFormula{"true", "", {}}}};
+    if (!checker.check(eg, &trace) || trace.states.size() != 2 || trace.loopStart != 1) return false;
+    if (trace.states[0].at("q") || !trace.states[1].at("q")) return false;
+
+    CTLFormula af{"AF", "", {CTLFormula{"false", "", {}}}};
+    return !checker.check(af, &trace) && trace.states.size() == 2 && trace.loopStart == 1;
+}
+
+// Other threads see the main manager, scratch work leaves it alone, and the cofactors that
+// split construction builds in worker managers merge into the same nodes a plain build gives.
+static bool selfCheckManagers() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder plain;
+    plain.buildROBDD(generateAdder(6));
+    size_t mainNodes = manager->nodeTable.size();
+    vector<string> mainOrder = manager->variableOrder;
+
+    bool workerSeesMain = false;
+    thread worker([&]() {
+        workerSeesMain = manager == &mainManager && getVariableIndex(mainOrder.back()) == (int)mainOrder.size() - 1;
+    });
+    worker.join();
+    if (!workerSeesMain) return false;
+
+    {
+        BDDManager scratch;
+        ManagerScope scope(scratch);
+        ROBDDBuilder other;
+        other.buildROBDD(generateParity(8));
+        if (manager->nodeTable.empty()) return false;
+    }
+    if (manager != &mainManager || manager->nodeTable.size() != mainNodes || manager->variableOrder != mainOrder)
+        return false;
+
+    ROBDDBuilder split;
+    split.buildSplitROBDD(generateAdder(6), 3);
+    vector<pair<string, BDDNode*>> expected = plain.getOutputBDDs();
+    vector<pair<string, BDDNode*>> actual = split.getOutputBDDs();
+    return actual == expected && manager->nodeTable.size() == mainNodes;
+}
+
+// A design whose inputs clash with the live BDDs must fail to parse rather than build on a
+// stale order; registers of a sequential design are registered as variables.
+static bool selfCheckParseOrder() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder first;
+    BDDNode* sum = first.buildROBDD(generateAdder(3));
+    vector<string> order = manager->variableOrder;
+    size_t nodes = manager->nodeTable.size();
+
+    ROBDDBuilder clash;
+    if (clash.buildROBDD(generateParity(4)) != nullptr) return false;
+    if (manager->variableOrder != order || manager->nodeTable.size() != nodes || !sum) return false;
+
+    resetBDDTables();
+    ROBDDBuilder fresh;
+    if (!fresh.buildROBDD(generateParity(4))) return false;
+
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder sequential;
+    vector<pair<string, BDDNode*>> next = sequential.buildSequential(
+        "module s(a, o);\ninput a;\noutput o;\nwire d, q;\nxor(d, a, q);\ndff(q, d);\nor(o, q, q);\nendmodule\n");
+    return next.size() == 1 && manager->variableOrder == vector<string>{"a", "q"};
+}
+
+// f = ab ^ cd ^ e ties bound sets {a,b} (one encoding function) and {a,b,c} (two) at a
+// gain of one; the smaller one must win. The network must compute f, and mapping must
+// leave the caller's order and nodes alone.
+static bool selfCheckLUTMapping() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    BDDNode* f = builder.buildROBDD("module m(a, b, c, d, e, f);\ninput a, b, c, d, e;\noutput f;\nwire p, q, r;\n"
+                                    "and(p, a, b);\nand(q, c, d);\nxor(r, p, q);\nxor(f, r, e);\nendmodule\n");
+    vector<string> order = manager->variableOrder;
+    size_t nodes = manager->nodeTable.size();
+    LUTNetwork network = mapToLUTs(builder.getOutputBDDs(), 3);
+    if (manager->variableOrder != order || manager->nodeTable.size() != nodes) return false;
+
+    int alphas = 0;
+    for (const LUT& lut : network.luts) {
+        if (lut.output.rfind("alpha", 0) != 0) continue;
+        if (alphas++ == 0 && lut.inputs != vector<string>{"a", "b"}) return false;
+    }
+    if (alphas == 0) return false;
+
+    for (unsigned m = 0; m < 32; ++m) {
+        map<string, bool> value;
+        for (size_t i = 0; i < order.size(); ++i) value[order[i]] = (m >> i) & 1;
+        BDDNode* n = f;
+        while (!isTerminal(n)) n = value[n->variable] ? n->high : n->low;
+        for (const LUT& lut : network.luts) {
+            size_t row = 0;
+            for (size_t i = 0; i < lut.inputs.size(); ++i) row |= (size_t)value[lut.inputs[i]] << i;
+            value[lut.output] = lut.truthTable[row];
+        }
+        if (value[network.outputs[0].second] != (n == BDD_ONE)) return false;
+    }
+    return true;
+}
+
+// o = !(!y & z | !x) is the cell ab | !c with permuted and complemented inputs and a
+// complemented output. The match must wire it back to o, three-input parity must match
+// nothing, and loading the library must leave the design's BDDs alone.
+static bool selfCheckNPNMatch() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    BDDNode* f = builder.buildROBDD("module f(x, y, z, o);\ninput x, y, z;\noutput o;\nwire ny, t, nx, u;\n"
+                                    "not(ny, y);\nand(t, ny, z);\nnot(nx, x);\nor(u, t, nx);\nnot(o, u);\nendmodule\n");
+    vector<string> order = manager->variableOrder;
+    size_t nodes = manager->nodeTable.size();
+
+    CellLibrary library;
+    if (library.loadVerilog("module ao(a, b, c, y);\ninput a, b, c;\noutput y;\nwire t, n;\n"
+                            "and(t, a, b);\nnot(n, c);\nor(y, t, n);\nendmodule\n") != 1)
+        return false;
+    if (manager->variableOrder != order || manager->nodeTable.size() != nodes) return false;
+
+    vector<CellMatch> matches = library.match(f);
+    if (matches.size() != 1 || matches[0].cell->pins != vector<string>{"a", "b", "c"}) return false;
+    const CellMatch& m = matches[0];
+    for (unsigned x = 0; x < 8; ++x) {
+        map<string, bool> value{{"x", x & 1}, {"y", (x >> 1) & 1}, {"z", (x >> 2) & 1}};
+        bool pin[3];
+        for (int j = 0; j < 3; ++j) pin[j] = value[m.inputs[j]] != m.inputNegated[j];
+        bool cell = ((pin[0] && pin[1]) || !pin[2]) != m.outputNegated;
+        BDDNode* n = f;
+        while (!isTerminal(n)) n = value[n->variable] ? n->high : n->low;
+        if (cell != (n == BDD_ONE)) return false;
+    }
+
+    ROBDDBuilder parity;
+    resetBDDTables();
+    return library.match(parity.buildROBDD(generateParity(3))).empty();
+}
+
+// Registers b and a always agree and c never reaches the output, so the three reachable
+// states fall into two classes and one state bit. The quotient keeps the CTL answers.
+static bool selfCheckFSMMinimization() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    TransitionSystem ts = buildTransitionSystem(
+        "module red(x, y);\ninput x;\noutput y;\nreg a, b, c, d;\nwire t, c_d, d_d;\nxor(t, a, x);\n"
+        "dff(a, t);\ndff(b, t);\nor(c_d, c, x);\ndff(c, c_d);\nand(d_d, d, x);\ndff(d, d_d);\n"
+        "and(y, a, b);\nendmodule\n");
+    StateMinimization minimized = minimizeStates(ts);
+    if (minimized.reachableStates != 3 || minimized.classes.size() != 2 || minimized.quotient.stateVars.size() != 1)
+        return false;
+
+    CTLFormula y{"atom", "y", {}};
+    CTLFormula notY{"!", "", {y}};
+    vector<CTLFormula> formulas = {CTLFormula{"EF", "", {y}}, CTLFormula{"AG", "", {CTLFormula{"EF", "", {notY}}}},
+                                   CTLFormula{"AX", "", {y}}};
+    CTLChecker original(ts), quotient(minimized.quotient);
+    for (const CTLFormula& f : formulas) {
+        if (original.check(f) != quotient.check(f)) return false;
+    }
+    return original.check(formulas[0]) && !original.check(formulas[2]);
+}
+
+static BMDWeight bmdEvaluate(BMDEdge e, const map<string, bool>& value) {
+    if (e.weight == 0 || e.node == BMD_ONE) return e.weight;
+    BMDWeight low = bmdEvaluate(e.node->low, value);
+    return e.weight * (value.at(e.node->variable) ? low + bmdEvaluate(e.node->high, value) : low);
+}
+
+// The *BMD of a 4-bit adder's sum word is A + B and agrees with the ROBDDs of the sum bits
+// on every input. A netlist that reads an undriven wire is refused.
+static bool selfCheckBMDRoundTrip() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(4));
+    vector<string> inputs = builder.getParserInputs();
+    vector<pair<string, BDDNode*>> outputs = builder.getOutputBDDs();
+    vector<string> word;
+    for (const auto& out : outputs) word.push_back(out.first);  // s0..s3, cout
+
+    BMDEdge sum{0, nullptr};
+    if (!bmdFromNetlist(builder.getParserGates(), inputs, word, sum)) return false;
+    vector<string> a = signalsWithPrefix(inputs, "a"), b = signalsWithPrefix(inputs, "b");
+    if (sum != bmdAdd(bmdWord(a), bmdWord(b))) return false;
+
+    for (unsigned x = 0; x < (1u << inputs.size()); ++x) {
+        map<string, bool> value;
+        for (size_t i = 0; i < inputs.size(); ++i) value[inputs[i]] = (x >> i) & 1;
+        BMDWeight expected = 0;
+        for (size_t o = 0; o < outputs.size(); ++o) {
+            BDDNode* n = outputs[o].second;
+            while (!isTerminal(n)) n = value[n->variable] ? n->high : n->low;
+            if (n == BDD_ONE) expected += (BMDWeight)1 << o;
+        }
+        if (bmdEvaluate(sum, value) != expected) return false;
+    }
+
+    BMDEdge open{0, nullptr};
+    return !bmdFromNetlist({Gate{"and", "y", {"a0", "w"}}}, {"a0"}, {"y"}, open);
+}
+
+// An adder image evaluates like its BDDs; images with a child that does not point below
+// its node, a root or level out of range, or a cut-off end are refused when mapped.
+static bool selfCheckImageValidation() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(3));
+    vector<BDDNode*> roots;
+    vector<string> names;
+    for (const auto& out : builder.getOutputBDDs()) {
+        roots.push_back(out.second);
+        names.push_back(out.first);
+    }
+    vector<char> image = serializeBDDImage(roots, names);
+    BDDImageView view = viewBDDImage(image.data(), image.size());
+    if (!view.valid()) return false;
+
+    size_t numVars = manager->variableOrder.size();
+    for (unsigned x = 0; x < (1u << numVars); ++x) {
+        vector<bool> levelValues(numVars);
+        for (size_t l = 0; l < numVars; ++l) levelValues[l] = (x >> l) & 1;
+        for (uint32_t r = 0; r < roots.size(); ++r) {
+            BDDNode* n = roots[r];
+            while (!isTerminal(n)) n = levelValues[getVariableIndex(n->variable)] ? n->high : n->low;
+            bool value = false;
+            if (!evaluateImage(view, r, levelValues, value) || value != (n == BDD_ONE)) return false;
+        }
+    }
+    bool value = false;
+    if (evaluateImage(view, (uint32_t)roots.size(), vector<bool>(numVars), value)) return false;
+
+    uint32_t last = view.header->numNodes - 1;
+    size_t lastNode = view.header->nodesOffset + last * sizeof(BDDImageNode);
+    vector<function<void(vector<char>&)>> corruptions = {
+        [&](vector<char>& bad) { reinterpret_cast<BDDImageNode*>(bad.data() + lastNode)->high = last; },
+        [&](vector<char>& bad) { reinterpret_cast<BDDImageNode*>(bad.data() + lastNode)->level = (uint32_t)numVars; },
+        [&](vector<char>& bad) { *reinterpret_cast<uint32_t*>(bad.data() + view.header->rootsOffset) = last + 1; },
+        [&](vector<char>& bad) { bad.resize(bad.size() - 8); },
+    };
+    for (const auto& corrupt : corruptions) {
+        vector<char> bad = image;
+        corrupt(bad);
+        if (viewBDDImage(bad.data(), bad.size()).valid()) return false;
+    }
+    return true;
+}
+
+// A reset frees the nodes, so the node arena goes back to where it was before the build.
+static bool selfCheckMemoryReset() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    int64_t before = memCurrent[MEM_NODES].load();
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(6));
+    if (memCurrent[MEM_NODES].load() <= before) return false;
+    resetBDDTables();
+    return memCurrent[MEM_NODES].load() == before;
+}
+
+// Of the 2^20 input pairs of a 10-bit adder, 2^9 * (2^10 - 1) = 523776 carry out, and
+// every sum bit is 1 for exactly half of them, however many threads count.
+static bool selfCheckAdderSatCount() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD(generateAdder(10));
+    vector<pair<string, BDDNode*>> outputs = builder.getOutputBDDs();
+    vector<BDDNode*> roots;
+    for (const auto& out : outputs) roots.push_back(out.second);
+    for (int threads : {1, 4}) {
+        vector<double> counts = parallelSatCount(roots, threads);
+        for (size_t o = 0; o < outputs.size(); ++o) {
+            double expected = outputs[o].first == "cout" ? 523776.0 : 524288.0;
+            if (counts[o] != expected) return false;
+        }
+    }
+    return true;
+}
+
+// y = a ^ b ^ c has widths 1, 2, 2; z = b ^ c is y's cofactor, so all three of its nodes
+// are shared and y keeps two of its five to itself.
+static bool selfCheckBDDProfile() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD("module p(a, b, c, y, z);\ninput a, b, c;\noutput y, z;\n"
+                       "xor(z, b, c);\nxor(y, a, z);\nendmodule\n");
+    BDDProfile profile = computeBDDProfile(builder.getOutputBDDs());
+    return profile.totalNodes == 5 && profile.levelWidth == vector<int>{1, 2, 2} &&
+           profile.outputNodes == vector<int>{5, 3} && profile.outputShared == vector<int>{3, 3} &&
+           profile.outputExclusive == vector<int>{2, 0} &&
+           profile.pairShared == vector<vector<int>>{{5, 3}, {3, 3}};
+}
+
+// Closed forms with P(a) = 0.3, P(b) = 0.6, P(c) = 0.8. For a & b: both marginals are 1,
+// and a's Birnbaum importance and influence are P(b). For a | c, P(f) = 0.86; b is
+// skipped, so it keeps its prior as the marginal and gets no importance. For a ^ b, a's
+// Birnbaum importance is P(!b) - P(b) = -0.2 while its influence is 1.
+static bool selfCheckSensitivityKnownAnswer() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    ROBDDBuilder builder;
+    builder.buildROBDD("module s(a, b, c, x, y, z);\ninput a, b, c;\noutput x, y, z;\n"
+                       "and(x, a, b);\nor(y, a, c);\nxor(z, a, b);\nendmodule\n");
+    vector<BDDNode*> roots;
+    for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+    vector<vector<VariableSensitivity>> stats = variableSensitivities(roots, {{"a", 0.3}, {"b", 0.6}, {"c", 0.8}});
+
+    // {marginal, birnbaum, influence} per output and level (a, b, c).
+    double expected[3][3][3] = {{{1, 0.6, 0.6}, {1, 0.3, 0.3}, {0.8, 0, 0}},
+                                {{0.3 / 0.86, 0.2, 0.2}, {0.6, 0, 0}, {0.8 / 0.86, 0.7, 0.7}},
+                                {{0.3 * 0.4 / 0.54, -0.2, 1}, {0.6 * 0.7 / 0.54, 0.4, 1}, {0.8, 0, 0}}};
+    for (int o = 0; o < 3; ++o) {
+        for (int l = 0; l < 3; ++l) {
+            const VariableSensitivity& s = stats[o][l];
+            if (fabs(s.marginal - expected[o][l][0]) > 1e-12 || fabs(s.birnbaum - expected[o][l][1]) > 1e-12 ||
+                fabs(s.influence - expected[o][l][2]) > 1e-12)
+                return false;
+        }
+    }
+    return true;
+}
+
+// (a0 & b0) | (a1 & b1) | (a2 & b2) declared with every a above every b takes 14 nodes.
+// Block sifting may only shrink the tables from there, and must leave them built with the
+// order it reports.
+// Splitting off the top one to three variables must give the same image as a plain build.
+static bool selfCheckBlockSiftSplit() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    string verilog = "module m(a0, a1, a2, b0, b1, b2, y);\ninput a0, a1, a2, b0, b1, b2;\noutput y;\n"
+                     "and(p0, a0, b0);\nand(p1, a1, b1);\nand(p2, a2, b2);\nor(y, p0, p1, p2);\nendmodule\n";
+    vector<BDDNode*> outputs;
+    rebuildROBDD(verilog, &outputs);
+    if (computeBDDProfile({{"y", outputs[0]}}).totalNodes != 14) return false;
+    int before = computeBDDSize();
+    double cost = blockSiftVariables(verilog, 2, 2);
+    if (cost > before || computeBDDSize() != (int)cost) return false;
+
+    vector<char> expected;
+    for (int depth : {0, 1, 2, 3}) {
+        resetBDDTables();
+        ROBDDBuilder builder;
+        builder.buildSplitROBDD(verilog, depth);
+        vector<char> image = serializeBDDImage({builder.getOutputBDDs()[0].second}, {"y"});
+        if (depth == 0) expected = image;
+        else if (image != expected) return false;
+    }
+    return true;
+}
+
+// Evaluating a & b visits one node, plus b's whenever a is 1, so with P(a) = 0.1 and
+// P(b) = 0.9 testing a first costs 1.1 nodes and b first 1.9. Both orders have two nodes,
+// so only the path-length objective moves a up. Parity visits every level on every path.
+static bool selfCheckPathLength() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    string verilog = "module p(b, a, y);\ninput b, a;\noutput y;\nand(y, a, b);\nendmodule\n";
+    map<string, double> prob = {{"a", 0.1}, {"b", 0.9}};
+    vector<BDDNode*> outputs;
+    rebuildROBDD(verilog, &outputs);
+    if (manager->variableOrder != vector<string>{"b", "a"} || fabs(expectedPathLength(outputs, prob) - 1.9) > 1e-12)
+        return false;
+
+    siftVariables(verilog, SiftObjective::NodeCount, prob);
+    if (manager->variableOrder != vector<string>{"b", "a"}) return false;
+    siftVariables(verilog, SiftObjective::ExpectedPathLength, prob);
+    rebuildROBDD(verilog, &outputs);
+    if (manager->variableOrder != vector<string>{"a", "b"} || fabs(expectedPathLength(outputs, prob) - 1.1) > 1e-12)
+        return false;
+
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    rebuildROBDD(generateParity(5), &outputs);
+    return fabs(expectedPathLength(outputs, {{"x0", 0.2}, {"x3", 0.7}}) - 5.0) < 1e-12;
+}
+
+// Two workers recycled after every job still return each design's image in job order,
+// byte for byte what serializing a local build of the design gives.
+static bool selfCheckWorkerPool() {
+    vector<BuildJob> jobs = {{"adder", generateAdder(4)}, {"parity", generateParity(6)},
+                             {"comparator", generateComparator(3)}};
+    vector<BuildJobResult> results;
+    {
+        ProcessWorkerPool pool(2, 0, 1);
+        results = pool.run(jobs);
+        if (pool.getRestarts() != 0) return false;
+    }
+    if (results.size() != jobs.size()) return false;
+
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        resetBDDTables();
+        setVariableOrder(vector<string>());
+        ROBDDBuilder builder;
+        builder.buildROBDD(jobs[j].verilogCode);
+        vector<BDDNode*> roots;
+        vector<string> names;
+        for (const auto& out : builder.getOutputBDDs()) {
+            names.push_back(out.first);
+            roots.push_back(out.second);
+        }
+        if (results[j].name != jobs[j].name || !results[j].ok || results[j].image != serializeBDDImage(roots, names))
+            return false;
+    }
+    return true;
+}
+
+// For y = a & b the high edge jumps to a label on b's node; for z = a | b the same node
+// follows its parent on the low edge, so it falls through without a label. The x64 variant
+// computes b's node once, as a mux of the constant lanes.
+static bool selfCheckCodegenText() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    newVarAtLevel(0, "a");
+    newVarAtLevel(1, "b");
+    BDDNode* a = makeNode("a", BDD_ZERO, BDD_ONE);
+    BDDNode* b = makeNode("b", BDD_ZERO, BDD_ONE);
+    BDDNode* y = apply(a, b, AndOp);
+    BDDNode* z = apply(a, b, OrOp);
+    string code = generateEvaluatorCpp({{"y", y}, {"z", z}}, "f");
+
+    string label = "n" + to_string(b->id);
+    string and2 = "inline bool f_0(const bool* in) {\n    if (in[0]) goto " + label + ";\n    return false;\n" +
+                  label + ":\n    return in[1];\n}\n";
+    string or2 = "inline bool f_1(const bool* in) {\n    if (in[0]) return true;\n    return in[1];\n}\n";
+    string lanes = "    const uint64_t " + label + " = (in[1] & ~UINT64_C(0)) | (~in[1] & UINT64_C(0));\n";
+    return code.find(and2) != string::npos && code.find(or2) != string::npos && code.find(lanes) != string::npos &&
+           code.find("out[0] = n" + to_string(y->id) + ";") != string::npos &&
+           code.find("out[1] = n" + to_string(z->id) + ";") != string::npos;
+}
+
+// With x in {0, 1, 2} and y in {0, 1, 2, 3}, f = (x != 1 && y odd) || (x == 1 && y == 0)
+// holds for 5 of the 12 assignments and needs three nodes. Over the four code bits the
+// encoded BDD has the same 5 minterms, since x's unused code 3 maps to 0, and decoding
+// gives f back. Some x makes f true for y in {0, 1, 3}; no x does for every y.
+static bool selfCheckMDDKnownAnswer() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    newMDDVar("check_x", 3);
+    newMDDVar("check_y", 4);
+    MDDNode *xOther, *xOne, *yOdd, *yZero, *expected;
+    if (!mddLiteral("check_x", {0, 2}, xOther) || !mddLiteral("check_x", {1}, xOne) ||
+        !mddLiteral("check_y", {1, 3}, yOdd) || !mddLiteral("check_y", {0}, yZero) ||
+        !mddLiteral("check_y", {0, 1, 3}, expected))
+        return false;
+    MDDNode* f = mddApply(mddApply(xOther, yOdd, AndOp), mddApply(xOne, yZero, AndOp), OrOp);
+
+    int count = 0;
+    for (int x = 0; x < 3; ++x) {
+        for (int y = 0; y < 4; ++y) count += mddEvaluate(f, {{"check_x", x}, {"check_y", y}});
+    }
+    if (count != 5 || mddSize(f) != 3) return false;
+    if (mddExists(f, "check_x") != expected || mddForall(f, "check_y") != MDD_ZERO) return false;
+
+    MDDEncoding encoding = encodeMDDVariables();
+    BDDNode* encoded = mddToBDD(f, encoding);
+    if (parallelProbability({encoded}, map<string, double>())[0] * 16 != 5) return false;
+    MDDNode* decoded = nullptr;
+    return bddToMDD(encoded, encoding, decoded) && decoded == f;
+}
+
+// One build of a four-gate design is one parse, one build and four applies. Apply runs
+// inside build, so build's exclusive share plus apply's adds up to build's inclusive total.
+// The caller's profiling state is restored afterwards.
+static bool selfCheckPhaseProfile() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    vector<PhaseStats> saved(phaseStats, phaseStats + PHASE_COUNT);
+    bool wasEnabled = phaseProfilingEnabled;
+    fill(phaseStats, phaseStats + PHASE_COUNT, PhaseStats());
+    phaseProfilingEnabled = true;
+    lastPhaseSample = takePhaseSample();
+
+    ROBDDBuilder builder;
+    builder.buildROBDD("module f(a, b, c, y);\ninput a, b, c;\noutput y;\n"
+                       "and(p, a, b);\nor(q, b, c);\nxor(r, p, q);\nnot(y, r);\nendmodule\n");
+    vector<PhaseStats> stats(phaseStats, phaseStats + PHASE_COUNT);
+
+    phaseProfilingEnabled = wasEnabled;
+    copy(saved.begin(), saved.end(), phaseStats);
+
+    const PhaseStats& build = stats[PHASE_BUILD];
+    const PhaseStats& apply = stats[PHASE_APPLY];
+    if (stats[PHASE_PARSE].calls != 1 || build.calls != 1 || apply.calls != 4) return false;
+    if (fabs(build.seconds + apply.seconds - build.inclusiveSeconds) > 1e-6) return false;
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        if (build.counters[c] + apply.counters[c] != build.inclusiveCounters[c]) return false;
+    }
+    return true;
+}
+
+// Asking a lazy builder for y evaluates y's cone only: z's gates stay unbuilt until z is
+// asked for, and both outputs come out as the nodes an eager build of the design makes.
+static bool selfCheckLazyOutputs() {
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    string verilog = "module l(a, b, c, y, z);\ninput a, b, c;\noutput y, z;\n"
+                     "and(p, a, b);\nxor(y, p, c);\nor(q, b, c);\nnot(z, q);\nendmodule\n";
+    ROBDDBuilder eager;
+    eager.buildROBDD(verilog);
+    vector<pair<string, BDDNode*>> expected = eager.getOutputBDDs();
+
+    ROBDDBuilder lazy;
+    if (!lazy.prepareLazy(verilog)) return false;
+    if (lazy.getSignalBDD("y") != expected[0].second) return false;
+    map<string, BDDNode*> built = lazy.getParserSignalBDDs();
+    if (!built.count("p") || built.count("q") || built.count("z")) return false;
+    return lazy.getOutputBDDs() == expected;
+}
+
+// Three parity cones whose outputs are smaller than their insides, declared stage by
+// stage: the levelized sweep holds every cone's intermediate signals at once, the cone
+// policies one cone's. All policies must build the same outputs from the same nodes.
+static bool selfCheckSchedulePolicies() {
+    stringstream v;
+    v << "module s(a0, a1, a2, a3, b0, b1, b2, b3, c0, c1, c2, c3, y, z, w);\n"
+      << "input a0, a1, a2, a3, b0, b1, b2, b3, c0, c1, c2, c3;\noutput y, z, w;\n";
+    vector<pair<string, string>> cones = {{"a", "y"}, {"b", "z"}, {"c", "w"}};
+    for (const auto& c : cones) v << "xor(" << c.first << "p, " << c.first << "0, " << c.first << "1);\n";
+    for (const auto& c : cones) v << "xor(" << c.first << "q, " << c.first << "p, " << c.first << "2);\n";
+    for (const auto& c : cones) v << "xor(" << c.first << "r, " << c.first << "q, " << c.first << "3);\n";
+    for (const auto& c : cones) v << "and(" << c.second << ", " << c.first << "r, " << c.first << "3);\n";
+    v << "endmodule\n";
+    string verilog = v.str();
+
+    vector<ScheduleReport> reports = compareSchedulePolicies(verilog);
+    if (reports.size() != 3) return false;
+    for (const ScheduleReport& report : reports) {
+        if (report.allocatedNodes != reports[0].allocatedNodes) return false;
+        if (report.policy != SchedulePolicy::Levelized && report.peakLiveNodes >= reports[0].peakLiveNodes) return false;
+    }
+
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    vector<pair<string, BDDNode*>> expected;
+    for (SchedulePolicy p : {SchedulePolicy::Levelized, SchedulePolicy::DepthFirstCone, SchedulePolicy::ConeMaxFree}) {
+        ROBDDBuilder builder;
+        builder.setSchedulePolicy(p);
+        builder.buildROBDD(verilog);
+        if (expected.empty()) expected = builder.getOutputBDDs();
+        else if (builder.getOutputBDDs() != expected) return false;
+    }
+    return true;
+}
+
+int runSelfChecks() {
+    vector<pair<string, function<bool()>>> checks = {
+        {"sensitivity known answer", selfCheckSensitivityKnownAnswer},
+        {"block sift and split", selfCheckBlockSiftSplit},
+        {"path length", selfCheckPathLength},
+        {"worker pool", selfCheckWorkerPool},
+        {"codegen text", selfCheckCodegenText},
+        {"MDD known answer", selfCheckMDDKnownAnswer},
+        {"phase profile", selfCheckPhaseProfile},
+        {"lazy outputs", selfCheckLazyOutputs},
+        {"schedule policies", selfCheckSchedulePolicies},
+        {"BDD profile", selfCheckBDDProfile},
+        {"adder satcount", selfCheckAdderSatCount},
+        {"memory reset", selfCheckMemoryReset},
+        {"image validation", selfCheckImageValidation},
+        {"BMD round trip", selfCheckBMDRoundTrip},
+        {"FSM minimization", selfCheckFSMMinimization},
+        {"NPN match", selfCheckNPNMatch},
+        {"LUT mapping", selfCheckLUTMapping},
+        {"parse order", selfCheckParseOrder},
+        {"managers", selfCheckManagers},
+        {"fair EG witness", selfCheckFairEGWitness},
+        {"KFDD types", selfCheckKFDDTypes},
+        {"slowdown test", selfCheckSlowdownTest},
+        {"variable order", selfCheckVariableOrder},
+        {"compact file", selfCheckCompactFile},
+        {"MDD errors", selfCheckMDDErrors},
+        {"parallel probability", selfCheckParallelProbability},
+        {"parallel sensitivity", selfCheckParallelSensitivity},
+        {"parity influence", selfCheckParityInfluence},
+    };
+    int failures = 0;
+    for (const auto& check : checks) {
+        bool ok = check.second();
+        cout << (ok ? "ok     " : "FAILED ") << check.first << endl;
+        if (!ok) failures++;
+    }
+    resetBDDTables();
+    setVariableOrder(vector<string>());
+    return failures;
+}
+
+// -------------------------------- Main --------------------------------------//
+int main(int argc, char* argv[]) {
+    string imagePath;
+    string shmName;
+    string compactPath;
+    bool showSatCount = false;
+    bool showProfile = false;
+    bool profileJSON = false;
+    bool scheduleReport = false;
+    vector<string> requestedOutputs;
+    bool showStats = false;
+    bool showMemory = false;
+    string benchOut;
+    string benchBaseline;
+    int benchRuns = 5;
+    double benchThreshold = 0.05;
+    vector<string> benchFiles;
+    int lutInputs = 0;
+    bool showKFDD = false;
+    vector<pair<string, int>> mddVariables;
+    vector<string> multiplierWords;
+    string cppPath;
+    bool splitBuild = false;
+    int poolWorkers = 0;
+    size_t poolMemoryMB = 0;
+    int poolRecycle = 0;
+    int splitDepth = -1;
+    bool siftRequested = false;
+    SiftObjective siftObjective = SiftObjective::NodeCount;
+    map<string, double> inputProb;
+    bool showPathLength = false;
+    bool showSensitivity = false;
+    bool selfCheck = false;
+    bool minimizeFSM = false;
+    vector<string> ctlFormulas;
+    vector<string> fairnessFormulas;
+    string libraryPath;
+    int siftBlockThreads = -1;
+    bool autotune = false;
+    string familyName;
+    string tuningPath = defaultTuningProfilePath();
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--image" && i + 1 < argc) imagePath = argv[++i];
+        else if (arg == "--shm" && i + 1 < argc) shmName = argv[++i];
+        else if (arg == "--compact" && i + 1 < argc) compactPath = argv[++i];
+        else if (arg == "--satcount") showSatCount = true;
+        else if (arg == "--profile") showProfile = true;
+        else if (arg == "--profile-json") profileJSON = true;
+        else if (arg == "--schedule-report") scheduleReport = true;
+        else if (arg == "--output" && i + 1 < argc) requestedOutputs.push_back(argv[++i]);
+        else if (arg == "--stats") showStats = true;
+        else if (arg == "--memory") showMemory = true;
+        else if (arg == "--lut" && i + 1 < argc) lutInputs = atoi(argv[++i]);
+        else if (arg == "--kfdd") showKFDD = true;
+        else if (arg == "--emit-cpp" && i + 1 < argc) cppPath = argv[++i];
+        else if (arg == "--split") splitBuild = true;
+        else if (arg == "--path-length") showPathLength = true;
+        else if (arg == "--sensitivity") showSensitivity = true;
+        else if (arg == "--self-check") selfCheck = true;
+        else if (arg == "--minimize") minimizeFSM = true;
+        else if (arg == "--match-library" && i + 1 < argc) libraryPath = argv[++i];
+        else if (arg == "--autotune") autotune = true;
+        else if (arg == "--family" && i + 1 < argc) familyName = argv[++i];
+        else if (arg == "--tuning-profiles" && i + 1 < argc) tuningPath = argv[++i];
+        else if (arg == "--ctl" && i + 1 < argc) ctlFormulas.push_back(argv[++i]);
+        else if (arg == "--fair" && i + 1 < argc) fairnessFormulas.push_back(argv[++i]);
+        else if (arg == "--sift" && i + 1 < argc) {
+            siftRequested = true;
+            string objective = argv[++i];
+            if (objective == "paths") siftObjective = SiftObjective::ExpectedPathLength;
+            else if (objective != "nodes") cerr << "Unknown sift objective " << objective << ", using nodes" << endl;
+        }
+        else if (arg == "--sift-blocks" && i + 1 < argc) {
+            siftRequested = true;
+            siftBlockThreads = max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--mdd" && i + 1 < argc) {
+            string declaration = argv[++i];
+            size_t eq = declaration.find('=');
+            if (eq != string::npos) mddVariables.push_back(make_pair(declaration.substr(0, eq), atoi(declaration.c_str() + eq + 1)));
+        }
+        else if (arg == "--input-prob" && i + 1 < argc) {
+            string assignment = argv[++i];
+            size_t eq = assignment.find('=');
+            if (eq != string::npos) inputProb[assignment.substr(0, eq)] = atof(assignment.c_str() + eq + 1);
+        }
+        else if (arg == "--pool" && i + 1 < argc) poolWorkers = max(1, atoi(argv[++i]));
+        else if (arg == "--pool-memory" && i + 1 < argc) poolMemoryMB = (size_t)atol(argv[++i]);
+        else if (arg == "--pool-recycle" && i + 1 < argc) poolRecycle = atoi(argv[++i]);
+        else if (arg == "--split-depth" && i + 1 < argc) {
+            splitBuild = true;
+            splitDepth = atoi(argv[++i]);
+        }
+        else if (arg == "--verify-mult" && i + 3 < argc) {
+            multiplierWords = {argv[i + 1], argv[i + 2], argv[i + 3]};
+            i += 3;
+        }
+        else if (arg == "--bench" && i + 1 < argc) benchOut = argv[++i];
+        else if (arg == "--bench-compare" && i + 1 < argc) benchBaseline = argv[++i];
+        else if (arg == "--bench-runs" && i + 1 < argc) benchRuns = max(1, atoi(argv[++i]));
+        else if (arg == "--bench-threshold" && i + 1 < argc) benchThreshold = atof(argv[++i]);
+        else if (arg == "--schedule" && i + 1 < argc) {
+            if (!parseSchedulePolicy(argv[++i], gateSchedulePolicy))
+                cerr << "Unknown schedule policy " << argv[i] << ", using levelized" << endl;
+        }
+        else if (arg.rfind("--", 0) != 0) benchFiles.push_back(arg);
+    }
+
+    // Extra circuit files only make sense for the benchmark and batch modes; the design
+    // itself is read from stdin.
+    if (!benchFiles.empty() && benchOut.empty() && benchBaseline.empty() && poolWorkers == 0) {
+        cerr << "Unexpected argument " << benchFiles.front() << " (circuit files need --bench, --bench-compare or --pool)" << endl;
+        return 2;
+    }
+
+    if (showStats) enablePhaseProfiling();
+
+    if (selfCheck) return runSelfChecks() > 0 ? 1 : 0;
+
+    if (!benchOut.empty() || !benchBaseline.empty()) {
+        vector<BenchCircuit> circuits = builtinBenchCircuits();
+        for (const string& file : benchFiles) {
+            ifstream in(file);
+            stringstream contents;
+            contents << in.rdbuf();
+            if (!in) {
+                cerr << "Cannot read " << file << endl;
+                return 2;
+            }
+            circuits.push_back(BenchCircuit{file, contents.str()});
+        }
+
+        vector<BenchResult> results = runBenchmarks(circuits, benchRuns);
+        if (!benchOut.empty() && !writeBenchResults(benchOut, results)) {
+            cerr << "Failed to write benchmark results to " << benchOut << endl;
+            return 2;
+        }
+        if (benchBaseline.empty()) return 0;
+
+        vector<BenchResult> baseline;
+        if (!readBenchResults(benchBaseline, baseline)) {
+            cerr << "Cannot read benchmark baseline " << benchBaseline << endl;
+            return 2;
+        }
+        int regressions = compareBenchResults(baseline, results, benchThreshold);
+        cout << regressions << " regression(s)" << endl;
+        return regressions > 0 ? 1 : 0;
+    }
+
+    // Batch mode: build every file given on the command line in isolated worker processes.
+    if (poolWorkers > 0) {
+        vector<BuildJob> jobs;
+        for (const string& file : benchFiles) {
+            ifstream in(file);
+            stringstream contents;
+            contents << in.rdbuf();
+            if (!in) {
+                cerr << "Cannot read " << file << endl;
+                return 2;
+            }
+            jobs.push_back(BuildJob{file, contents.str()});
+        }
+
+        ProcessWorkerPool pool(poolWorkers, poolMemoryMB << 20, poolRecycle);
+        int failures = 0;
+        for (const BuildJobResult& result : pool.run(jobs)) {
+            BDDImageView view = viewBDDImage(result.image.data(), result.image.size());
+            if (result.ok && view.valid()) {
+                cout << result.name << ": " << view.header->numRoots << " outputs, " << view.header->numNodes - 2
+                     << " nodes" << endl;
+            } else {
+                cout << result.name << ": failed (" << (result.ok ? "bad image" : result.error) << ")" << endl;
+                failures++;
+            }
+        }
+        if (pool.getRestarts() > 0) cout << pool.getRestarts() << " worker restart(s)" << endl;
+        return failures > 0 ? 1 : 0;
+    }
+
+    cout << "Enter combinational Verilog design (end with 'endmodule'):" << endl;
+
+    string line;
+    string verilogCode;
+
+    while (getline(cin, line)) {
+        verilogCode += line + "\n";
+        if (line.find("endmodule") != string::npos) break;
+    }
+
+    // --autotune calibrates on this design and stores the result for its family; without
+    // it, a stored profile for the family is used when there is one.
+    TuningProfile tuning;
+    {
+        string family = familyName.empty() ? designFamily(verilogCode) : familyName;
+        map<string, TuningProfile> profiles;
+        readTuningProfiles(tuningPath, profiles);
+        if (autotune) {
+            tuning = autotuneDesign(verilogCode, family);
+            profiles[family] = tuning;
+            if (!writeTuningProfiles(tuningPath, profiles)) cerr << "Failed to write tuning profiles to " << tuningPath << endl;
+            cout << "Tuned " << family << ": cache " << tuning.applyCacheEntries << ", threads " << tuning.threads
+                 << ", reorder above " << tuning.reorderThreshold << " nodes, " << tuning.gatesPerSecond
+                 << " gates/s" << endl;
+        } else if (profiles.count(family)) {
+            tuning = profiles[family];
+        }
+        applyTuningProfile(tuning);
+    }
+
+    // Multipliers blow up as BDDs whatever the order, so this check skips the BDD flow.
+    if (!multiplierWords.empty()) {
+        bool ok = verifyMultiplier(verilogCode, multiplierWords[0], multiplierWords[1], multiplierWords[2]);
+        cout << multiplierWords[2] << (ok ? " == " : " != ") << multiplierWords[0] << " * " << multiplierWords[1] << endl;
+        return ok ? 0 : 1;
+    }
+
+    // The sequential flow starts from empty tables and ends the run once the formulas are
+    // checked; minimization adds its variables to the same manager.
+    if (!ctlFormulas.empty() || minimizeFSM) {
+        resetBDDTables();
+        setVariableOrder(vector<string>());
+        TransitionSystem ts = buildTransitionSystem(verilogCode);
+        if (minimizeFSM) {
+            StateMinimization minimized = minimizeStates(ts);
+            cout << "States: " << minimized.reachableStates << " reachable -> " << minimized.classes.size()
+                 << " classes (" << minimized.quotient.stateVars.size() << " state bits, was "
+                 << ts.stateVars.size() << "), " << minimized.iterations << " refinement iterations" << endl;
+            ts = minimized.quotient;
+        }
+        CTLParser ctlParser;
+        CTLChecker fairnessChecker(ts);
+        vector<BDDNode*> fairnessSets;
+        for (const string& text : fairnessFormulas) {
+            CTLFormula formula;
+            BDDNode* states = ctlParser.parse(text, formula) ? fairnessChecker.sat(formula) : nullptr;
+            if (!states) {
+                cerr << "Bad fairness constraint " << text << endl;
+                return 2;
+            }
+            fairnessSets.push_back(states);
+        }
+
+        CTLChecker checker(ts, fairnessSets);
+        int failures = 0;
+        for (const string& text : ctlFormulas) {
+            CTLFormula formula;
+            if (!ctlParser.parse(text, formula)) {
+                cout << text << ": syntax error" << endl;
+                failures++;
+                continue;
+            }
+            CTLTrace trace;
+            bool holds = checker.check(formula, &trace);
+            if (!checker.getError().empty()) {
+                cout << text << ": " << checker.getError() << endl;
+                failures++;
+                continue;
+            }
+            cout << text << ": " << (holds ? "holds" : "fails") << endl;
+            if (!holds) failures++;
+            if (!trace.states.empty()) cout << "  " << (holds ? "witness" : "counterexample") << ":" << endl;
+            for (size_t s = 0; s < trace.states.size(); ++s) {
+                cout << "    " << s << ":";
+                for (const string& var : checker.getStateVars()) cout << " " << var << "=" << trace.states[s][var];
+                cout << endl;
+            }
+            if (trace.loopStart >= 0) cout << "    loops back to " << trace.loopStart << endl;
+        }
+
+        const CTLStats& stats = checker.getStats();
+        if (!ctlFormulas.empty())
+            cout << "Fixpoints: " << stats.fixpoints << ", iterations: " << stats.iterations << ", pre-images: "
+                 << stats.preImages << ", peak frontier: " << stats.peakFrontierNodes << " nodes" << endl;
+        return failures > 0 ? 1 : 0;
+    }
+
+    // Cells keep only their canonical forms, each built in a scratch manager.
+    CellLibrary library;
+    if (!libraryPath.empty()) {
+        ifstream in(libraryPath);
+        stringstream contents;
+        contents << in.rdbuf();
+        if (!in) {
+            cerr << "Cannot read " << libraryPath << endl;
+            return 2;
+        }
+        library.loadVerilog(contents.str());
+    }
+
+    resetBDDTables();
+
+    // Perform sifting to optimize variable order and build final ROBDD. Sifting needs an
+    // order to start from, so --sift seeds it with the declared inputs. A tuning profile can
+    // ask for sifting once the design is large enough.
+    if (siftRequested || exceedsReorderThreshold(verilogCode, tuning.reorderThreshold)) {
+        VerilogParser seed;
+        seed.parse(verilogCode);
+    }
+    if (siftBlockThreads >= 0) blockSiftVariables(verilogCode, siftBlockThreads, 2, siftObjective, inputProb);
+    else siftVariables(verilogCode, siftObjective, inputProb);
 
     // Rebuild ROBDD using optimized variable order
-    uniqueTable.clear();
-    nodeTable.clear();
-    BDD_ZERO = new BDDNode("0", nullptr, nullptr);
-    BDD_ONE  = new BDDNode("1", nullptr, nullptr);
+    resetBDDTables();
 
     ROBDDBuilder builder;
-    BDDNode* finalRobdd = builder.buildROBDD(verilogCode);
+    if (requestedOutputs.empty()) {
+        BDDNode* finalRobdd = splitBuild ? builder.buildSplitROBDD(verilogCode, splitDepth)
+                                         : builder.buildROBDD(verilogCode);
+
+        cout << "\nROBDD After Sifting (Optimized):" << endl;
+        if (finalRobdd) printBDD(finalRobdd);
+        else cout << "Failed to generate optimized ROBDD" << endl;
+    } else {
+        // Only the cones of the requested outputs are evaluated.
+        builder.prepareLazy(verilogCode);
+        for (const string& name : requestedOutputs) {
+            cout << "\nROBDD After Sifting (Optimized) for " << name << ":" << endl;
+            BDDNode* bdd = builder.getSignalBDD(name);
+            if (bdd) printBDD(bdd);
+            else cout << "Unknown signal " << name << endl;
+        }
+    }
 
-    cout << "\nROBDD After Sifting (Optimized):" << endl;
-    if (finalRobdd) printBDD(finalRobdd);
-    else cout << "Failed to generate optimized ROBDD" << endl;
+    if (showSatCount) {
+        vector<pair<string, BDDNode*>> outputs = builder.getOutputBDDs();
+        vector<BDDNode*> roots;
+        for (const auto& out : outputs) roots.push_back(out.second);
+        vector<double> counts = parallelSatCount(roots);
+        cout << "\nSatisfying assignments:" << endl;
+        for (size_t i = 0; i < outputs.size(); ++i)
+            cout << "  " << outputs[i].first << ": " << counts[i] << endl;
+    }
+
+    if (showPathLength) {
+        cout << "\nExpected path length:" << endl;
+        double total = 0;
+        for (const auto& out : builder.getOutputBDDs()) {
+            double length = expectedPathLength({out.second}, inputProb);
+            total += length;
+            cout << "  " << out.first << ": " << length << endl;
+        }
+        cout << "  total: " << total << endl;
+    }
+
+    if (showSensitivity) {
+        vector<pair<string, BDDNode*>> outputs = builder.getOutputBDDs();
+        vector<BDDNode*> roots;
+        for (const auto& out : outputs) roots.push_back(out.second);
+        vector<vector<VariableSensitivity>> stats = variableSensitivities(roots, inputProb);
+        cout << "\nVariable sensitivity (P(x=1 | out=1), Birnbaum importance, influence):" << endl;
+        for (size_t o = 0; o < outputs.size(); ++o) {
+            cout << "  " << outputs[o].first << ":" << endl;
+            for (const VariableSensitivity& s : stats[o])
+                cout << "    " << s.variable << ": " << s.marginal << ", " << s.birnbaum << ", " << s.influence << endl;
+        }
+    }
+
+    if (showProfile || profileJSON) {
+        BDDProfile profile = computeBDDProfile(builder.getOutputBDDs());
+        cout << endl;
+        if (profileJSON) cout << profileToJSON(profile);
+        else printBDDProfile(profile);
+    }
+
+    if (!imagePath.empty() || !shmName.empty() || !compactPath.empty()) {
+        vector<BDDNode*> roots;
+        vector<string> rootNames;
+        for (const auto& out : builder.getOutputBDDs()) {
+            rootNames.push_back(out.first);
+            roots.push_back(out.second);
+        }
+        if (!imagePath.empty() && !writeBDDImageFile(imagePath, roots, rootNames))
+            cerr << "Failed to write BDD image to " << imagePath << endl;
+        if (!shmName.empty() && !writeBDDImageShm(shmName, roots, rootNames))
+            cerr << "Failed to write BDD image to shared memory " << shmName << endl;
+        if (!compactPath.empty() && !writeCompactBDDFile(compactPath, compressBDD(roots)))
+            cerr << "Failed to write compact BDD to " << compactPath << endl;
+    }
+
+    if (!cppPath.empty() && !writeEvaluatorCppFile(cppPath, builder.getOutputBDDs(), "robdd_eval"))
+        cerr << "Failed to write C++ evaluator to " << cppPath << endl;
+
+    if (showKFDD) {
+        vector<BDDNode*> roots;
+        for (const auto& out : builder.getOutputBDDs()) roots.push_back(out.second);
+        size_t bddNodes = collectNodes(roots).size() - 2;
+        size_t kfddNodes = 0;
+        chooseDecompositionTypes(roots, kfddNodes);
+        cout << "\nKFDD: " << kfddNodes << " nodes (ROBDD: " << bddNodes << "), decomposition types:";
+        for (const string& var : manager->variableOrder) {
+            Decomposition type = getDecomposition(var);
+            cout << " " << var << "=" << (type == Decomposition::Shannon ? "S" : type == Decomposition::PositiveDavio ? "pD" : "nD");
+        }
+        cout << endl;
+    }
+
+    // --mdd state=5 reads the inputs state_b0, state_b1, ... as the binary code of one
+    // enumerated variable, the way encodeMDDVariables names them.
+    if (!mddVariables.empty()) {
+        MDDEncoding encoding;
+        for (const auto& var : mddVariables) {
+            newMDDVar(var.first, var.second);
+            vector<string>& bits = encoding.bits[var.first];
+            for (int b = 0; b == 0 || (1 << b) < var.second; ++b) bits.push_back(var.first + "_b" + to_string(b));
+        }
+        cout << "\nMDD nodes:" << endl;
+        for (const auto& out : builder.getOutputBDDs()) {
+            MDDNode* mdd;
+            if (bddToMDD(out.second, encoding, mdd)) cout << "  " << out.first << ": " << mddSize(mdd) << endl;
+            else cerr << "Output " << out.first << " depends on inputs outside the MDD encoding" << endl;
+        }
+    }
+
+    if (!libraryPath.empty()) {
+        cout << "\nCell matches (" << library.size() << " library cells):" << endl;
+        for (const auto& signal : builder.getParserSignalBDDs()) {
+            if (!signal.second || isTerminal(signal.second) || bddSupport(signal.second) == vector<string>{signal.first})
+                continue;
+            vector<CellMatch> matches = library.match(signal.second);
+            if (matches.empty()) continue;
+            const CellMatch& m = matches.front();
+            cout << "  " << signal.first << " = " << (m.outputNegated ? "!" : "") << m.cell->name << "(";
+            for (size_t j = 0; j < m.inputs.size(); ++j)
+                cout << (j ? ", " : "") << m.cell->pins[j] << "=" << (m.inputNegated[j] ? "!" : "") << m.inputs[j];
+            cout << ")" << endl;
+        }
+    }
+
+    if (lutInputs > 0) {
+        cout << endl << lutNetworkToBLIF(mapToLUTs(builder.getOutputBDDs(), lutInputs));
+    }
+
+    if (showStats) {
+        cout << endl;
+        printStatsReport();
+    }
+
+    if (showMemory) {
+        cout << endl;
+        printMemoryReport();
+    }
+
+    // Each policy builds in a scratch manager of its own.
+    if (scheduleReport) {
+        cout << "\nSchedule policy (peak live nodes / allocated nodes):" << endl;
+        for (const ScheduleReport& report : compareSchedulePolicies(verilogCode)) {
+            cout << "  " << schedulePolicyName(report.policy) << ": " << report.peakLiveNodes << " / "
+                 << report.allocatedNodes << endl;
+        }
+    }
 
     return 0;
 }